@@ -0,0 +1,216 @@
+/*
+Thread placement for the benchmark threads.
+
+The CPU topology is read from /sys/devices/system/cpu and turned into an
+ordered list of logical CPUs. Thread i of an OpenMP team is pinned with
+sched_setaffinity to the i-th entry (modulo the number of entries).
+
+  none      : leave the placement to the OpenMP runtime / OS
+  compact   : one thread per physical core, fill a socket before the next
+              one, SMT siblings are only used when all cores are taken
+  scatter   : one thread per physical core, round robin over the sockets
+  smt_pairs : consecutive threads share a physical core (SMT siblings)
+  list      : explicit list of logical CPUs, e.g. "0-3,8,10"
+*/
+
+#pragma once
+#include <sched.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <tuple>
+#include <vector>
+
+namespace affinity
+{
+    enum class Placement
+    {
+        None,
+        Compact,
+        Scatter,
+        SmtPairs,
+        List
+    };
+
+    struct CpuInfo
+    {
+        int cpu{};
+        int core{};
+        int package{};
+        int smt_index{}; // position among the SMT siblings of the core
+        int core_rank{}; // position of the core inside its package
+    };
+
+    // Parses the kernel's cpu list format: "0-3,8,10-11"
+    inline std::vector<int> parse_cpu_list(std::string const &list)
+    {
+        std::vector<int> to_rtn;
+        std::stringstream ss(list);
+        std::string item;
+
+        while (std::getline(ss, item, ','))
+        {
+            if (item.empty())
+                continue;
+
+            auto dash = item.find('-');
+            if (dash == std::string::npos)
+            {
+                to_rtn.push_back(std::stoi(item));
+                continue;
+            }
+
+            int first = std::stoi(item.substr(0, dash));
+            int last = std::stoi(item.substr(dash + 1));
+            for (int cpu = first; cpu <= last; ++cpu)
+                to_rtn.push_back(cpu);
+        }
+        return to_rtn;
+    }
+
+    inline int read_int(std::string const &path, int fallback)
+    {
+        std::ifstream in(path);
+        int value;
+        if (in >> value)
+            return value;
+        return fallback;
+    }
+
+    inline std::vector<CpuInfo> read_topology()
+    {
+        std::string const root = "/sys/devices/system/cpu/";
+        std::vector<CpuInfo> to_rtn;
+
+        std::ifstream online(root + "online");
+        std::string online_list;
+        if (!(online >> online_list))
+            return to_rtn;
+
+        for (int cpu : parse_cpu_list(online_list))
+        {
+            std::string topo = root + "cpu" + std::to_string(cpu) + "/topology/";
+            CpuInfo info{};
+            info.cpu = cpu;
+            info.core = read_int(topo + "core_id", cpu);
+            info.package = read_int(topo + "physical_package_id", 0);
+            to_rtn.push_back(info);
+        }
+
+        // Number the SMT siblings of each core and the cores of each package
+        std::sort(to_rtn.begin(), to_rtn.end(), [](CpuInfo const &a, CpuInfo const &b)
+                  { return std::tie(a.package, a.core, a.cpu) <
+                           std::tie(b.package, b.core, b.cpu); });
+
+        std::map<std::pair<int, int>, int> siblings;
+        std::map<int, std::map<int, int>> cores_of_package;
+        for (auto &info : to_rtn)
+        {
+            info.smt_index = siblings[{info.package, info.core}]++;
+            auto &cores = cores_of_package[info.package];
+            auto it = cores.find(info.core);
+            if (it == cores.end())
+                it = cores.emplace(info.core, int(cores.size())).first;
+            info.core_rank = it->second;
+        }
+
+        return to_rtn;
+    }
+
+    // Logical CPUs in the order in which threads are placed on them
+    inline std::vector<int> cpu_order(Placement placement,
+                                      std::vector<int> const &cpu_list = {})
+    {
+        if (placement == Placement::None)
+            return {};
+        if (placement == Placement::List)
+            return cpu_list;
+
+        std::vector<CpuInfo> topology = read_topology();
+
+        switch (placement)
+        {
+        case Placement::Compact:
+            std::sort(topology.begin(), topology.end(), [](CpuInfo const &a, CpuInfo const &b)
+                      { return std::tie(a.smt_index, a.package, a.core_rank) <
+                               std::tie(b.smt_index, b.package, b.core_rank); });
+            break;
+        case Placement::Scatter:
+            std::sort(topology.begin(), topology.end(), [](CpuInfo const &a, CpuInfo const &b)
+                      { return std::tie(a.smt_index, a.core_rank, a.package) <
+                               std::tie(b.smt_index, b.core_rank, b.package); });
+            break;
+        case Placement::SmtPairs:
+            std::sort(topology.begin(), topology.end(), [](CpuInfo const &a, CpuInfo const &b)
+                      { return std::tie(a.package, a.core_rank, a.smt_index) <
+                               std::tie(b.package, b.core_rank, b.smt_index); });
+            break;
+        default:
+            break;
+        }
+
+        std::vector<int> to_rtn;
+        to_rtn.reserve(topology.size());
+        for (auto const &info : topology)
+            to_rtn.push_back(info.cpu);
+        return to_rtn;
+    }
+
+    // Cpus this process may run on (cgroup / taskset limits included)
+    inline int online_cpus()
+    {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        if (sched_getaffinity(0, sizeof(set), &set) == 0 && CPU_COUNT(&set) > 0)
+            return CPU_COUNT(&set);
+        long n = sysconf(_SC_NPROCESSORS_ONLN);
+        return n > 0 ? int(n) : 1;
+    }
+
+    // Pins the calling thread. Returns false if the kernel refused.
+    inline bool pin_current_thread(int cpu)
+    {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        return sched_setaffinity(0, sizeof(set), &set) == 0;
+    }
+
+    inline std::string to_string(Placement placement)
+    {
+        switch (placement)
+        {
+        case Placement::None:
+            return "none";
+        case Placement::Compact:
+            return "compact";
+        case Placement::Scatter:
+            return "scatter";
+        case Placement::SmtPairs:
+            return "smt_pairs";
+        case Placement::List:
+            return "list";
+        }
+        return "unknown";
+    }
+
+    inline bool from_string(std::string const &name, Placement &placement)
+    {
+        static const std::map<std::string, Placement> names{
+            {"none", Placement::None},
+            {"compact", Placement::Compact},
+            {"scatter", Placement::Scatter},
+            {"smt_pairs", Placement::SmtPairs},
+            {"list", Placement::List}};
+
+        auto it = names.find(name);
+        if (it == names.end())
+            return false;
+        placement = it->second;
+        return true;
+    }
+}; // namespace affinity
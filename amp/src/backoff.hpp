@@ -0,0 +1,176 @@
+/*
+Backoff policies (contention managers) for the concurrent queues, the
+second template parameter next to the instrumentation policy. A queue
+keeps one policy object, built from the Parameters of the run, and calls
+
+  lock(l)            : takes an omp lock
+  failed(attempts)   : after a failed CAS of the algorithm, attempts counts
+                       the failures of the current operation
+
+None keeps the plain behaviour: omp_set_lock and immediate retries.
+SpinYield spins a few rounds with a pause and then yields the cpu on every
+further attempt. With more runnable threads than cpus the thread holding a
+lock, or the one whose CAS the others wait on, may be preempted; spinning
+for a whole time slice then only delays it further, yielding lets it run.
+Exponential pauses min_spins, 2 min_spins, ... up to max_spins times after
+consecutive failures, so the threads stop hammering the header and tail
+cache lines. Randomized pauses a uniformly drawn number of times below the
+same bound, which also breaks up threads that fail in lock step.
+*/
+
+#pragma once
+#include "spin.hpp"
+
+#include <omp.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <thread>
+
+namespace backoff
+{
+    enum class Kind
+    {
+        None,
+        SpinYield,
+        Exponential,
+        Randomized
+    };
+
+    inline std::string to_string(Kind kind)
+    {
+        switch (kind)
+        {
+        case Kind::None:
+            return "none";
+        case Kind::SpinYield:
+            return "spin_yield";
+        case Kind::Exponential:
+            return "exponential";
+        case Kind::Randomized:
+            return "randomized";
+        }
+        return "unknown";
+    }
+
+    inline bool from_string(std::string const &name, Kind &kind)
+    {
+        static const std::map<std::string, Kind> names{
+            {"none", Kind::None},
+            {"spin_yield", Kind::SpinYield},
+            {"exponential", Kind::Exponential},
+            {"randomized", Kind::Randomized}};
+
+        auto it = names.find(name);
+        if (it == names.end())
+            return false;
+        kind = it->second;
+        return true;
+    }
+
+    // Pauses of Exponential and Randomized
+    struct Parameters
+    {
+        unsigned min_spins{4};
+        unsigned max_spins{1024};
+
+        bool valid() const { return min_spins > 0 && min_spins <= max_spins; }
+    };
+
+    inline void pause(unsigned spins)
+    {
+        for (unsigned i = 0; i < spins; ++i)
+            spin::relax();
+    }
+
+    // Bound of the attempts-th consecutive failure, min_spins << attempts capped
+    inline unsigned window(Parameters const &p, unsigned attempts)
+    {
+        unsigned shift = std::min(attempts, 31u);
+        uint64_t spins = uint64_t(p.min_spins) << shift;
+        return unsigned(std::min<uint64_t>(spins, p.max_spins));
+    }
+
+    // Takes a lock by polling it and calling failed() between the polls
+    template <typename Policy>
+    void poll(Policy const &policy, omp_lock_t &l)
+    {
+        unsigned attempts = 0;
+        while (!omp_test_lock(&l))
+            policy.failed(attempts);
+    }
+
+    struct None
+    {
+        explicit None(Parameters = {}) {}
+
+        void lock(omp_lock_t &l) const { omp_set_lock(&l); }
+        void failed(unsigned &) const {}
+    };
+
+    struct SpinYield
+    {
+        static constexpr unsigned spins = 64; // attempts before the first yield
+
+        explicit SpinYield(Parameters = {}) {}
+
+        void failed(unsigned &attempts) const
+        {
+            if (++attempts <= spins)
+                spin::relax();
+            else
+                std::this_thread::yield();
+        }
+
+        void lock(omp_lock_t &l) const { poll(*this, l); }
+    };
+
+    struct Exponential
+    {
+        Parameters parameters;
+
+        explicit Exponential(Parameters p = {}) : parameters(p) {}
+
+        void failed(unsigned &attempts) const { pause(window(parameters, attempts++)); }
+        void lock(omp_lock_t &l) const { poll(*this, l); }
+    };
+
+    struct Randomized
+    {
+        Parameters parameters;
+
+        explicit Randomized(Parameters p = {}) : parameters(p) {}
+
+        void failed(unsigned &attempts) const
+        {
+            // xorshift, one state per thread
+            thread_local uint64_t state = 0x9E3779B97F4A7C15ull ^ uint64_t(omp_get_thread_num() + 1);
+            state ^= state << 13;
+            state ^= state >> 7;
+            state ^= state << 17;
+            pause(unsigned(state % (uint64_t(window(parameters, attempts++)) + 1)));
+        }
+
+        void lock(omp_lock_t &l) const { poll(*this, l); }
+    };
+
+    // Calls f.template operator()<Policy>() with the policy of kind
+    template <typename F>
+    auto dispatch(Kind kind, F &&f)
+    {
+        switch (kind)
+        {
+        case Kind::SpinYield:
+            return f.template operator()<SpinYield>();
+        case Kind::Exponential:
+            return f.template operator()<Exponential>();
+        case Kind::Randomized:
+            return f.template operator()<Randomized>();
+        case Kind::None:
+            break;
+        }
+        return f.template operator()<None>();
+    }
+}; // namespace backoff
@@ -1,5 +1,9 @@
 #pragma once
 #include "generics.hpp"
+#include "instrumentation.hpp"
+#include "memory.hpp"
+
+#include <optional>
 
 
 class BaseQueue{
@@ -9,6 +13,17 @@ class BaseQueue{
 
     virtual bool push(value_t v)= 0;
     virtual value_t pop()=0;
+    // -1 if the queue was built without size tracking (sizing.hpp)
     virtual int get_size() =0;
-    virtual ~BaseQueue() = default; 
-};
\ No newline at end of file
+
+    // Counters of the instrumentation policy, nullopt if the queue was built
+    // without one (instrumentation.hpp)
+    virtual std::optional<instrumentation::Contention> contention() const { return std::nullopt; }
+    virtual void reset_contention() {}
+
+    // Nodes allocated and free list occupancy, nullopt if the queue does not
+    // track them. Only consistent while no thread works on the queue.
+    virtual std::optional<memory::Allocation> allocation() const { return std::nullopt; }
+
+    virtual ~BaseQueue() = default;
+};
@@ -0,0 +1,294 @@
+/*
+Baskets queue (Hoffman, Shalev and Shavit, "The Baskets Queue").
+
+In the Michael-Scott queue every producer retries on the new tail after a
+failed tail CAS, so all producers serialize on one cache line. Here the
+producers that failed the CAS on the same tail's next pointer were
+concurrent with the winner, so any order among them is linearizable: they
+form a "basket" and insert themselves right behind the old tail instead
+of retrying at the new one.
+
+A next pointer carries, besides the pointer, a deleted bit and a tag. The
+tag of a link made at tail t is t.tag + 1, which is how a producer
+recognizes the basket it belongs to. Consumers do not move the head on
+every pop: they mark the link to the popped node as deleted and skip
+deleted links. A chain of deleted nodes is unlinked and handed to the
+popping thread's free list once it is max_hops long, or when it reaches
+the tail.
+
+The nodes, free lists and tagged pointers are the ones of lock_free_aba.
+The 16 bit version of a TaggedPointer holds the deleted bit in its top bit
+and a 15 bit tag below it. Link tags follow the tail tag, which wraps every
+32768 pushes, so a pop checks the head again right before its CAS: while
+the head has not moved no node behind it was recycled.
+*/
+
+#pragma once
+#include "backoff.hpp"
+#include "base_queue.hpp"
+#include "generics.hpp"
+#include "instrumentation.hpp"
+#include "lock_free_aba.hpp"
+#include "payload.hpp"
+#include "sizing.hpp"
+
+#include <omp.h>
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+namespace baskets
+{
+    using value_t = generics::value_t;
+    inline constexpr value_t empty_val = generics::empty_val;
+
+    inline constexpr unsigned max_hops = 3; // deleted nodes before the head moves
+    inline constexpr uint16_t deleted_bit = 0x8000;
+    inline constexpr uint16_t tag_mask = 0x7fff;
+
+    inline uint16_t next_tag(uint16_t tag, uint16_t by = 1) { return uint16_t((tag + by) & tag_mask); }
+
+    // Unpacked view of a TaggedPointer
+    template <typename Node>
+    struct Ref
+    {
+        Node *ptr{};
+        bool deleted{};
+        uint16_t tag{};
+
+        uint16_t version() const { return uint16_t((tag & tag_mask) | (deleted ? deleted_bit : 0)); }
+        bool operator==(Ref const &) const = default;
+    };
+
+    template <typename Node>
+    Ref<Node> load(TaggedPointer<Node> const &p)
+    {
+        auto [ptr, version] = p.load(std::memory_order_acquire);
+        return {ptr, (version & deleted_bit) != 0, uint16_t(version & tag_mask)};
+    }
+
+    template <typename Node>
+    void store(TaggedPointer<Node> &p, Ref<Node> const &r)
+    {
+        p.store(r.ptr, r.version(), std::memory_order_relaxed);
+    }
+
+    template <typename Node>
+    bool cas(TaggedPointer<Node> &p, Ref<Node> const &expected, Ref<Node> const &desired)
+    {
+        return p.compareAndSet(expected.ptr, expected.version(), desired.ptr, desired.version());
+    }
+
+    template <typename Instr = instrumentation::None, typename Backoff = backoff::None,
+              typename Payload = payload::None, typename Size = sizing::Shared>
+    class BasicQueue : public BaseQueue
+    {
+        using Node = lock_free_aba::BasicNode<typename Payload::Slot>;
+        using FreeList = lock_free_aba::BasicFreeList<Node>;
+        using Link = Ref<Node>;
+
+        alignas(64) TaggedPointer<Node> header;
+        alignas(64) TaggedPointer<Node> tail;
+
+        alignas(64) std::vector<FreeList> freelists;
+        Instr instr;
+        Payload messages;
+        Backoff manager;
+        Size tracker;
+
+        // Swings a lagging tail to the last node
+        void fix_tail(Link last, Link next)
+        {
+            if (load(next.ptr->next).ptr == nullptr && load(tail) == last)
+            {
+                instr.help();
+                instr.cas(cas(tail, last, {next.ptr, false, next_tag(last.tag)}));
+            }
+        }
+
+        // Moves the head from first to new_first and recycles the nodes in between
+        void free_chain(int tid, Link first, Link new_first)
+        {
+            bool moved = cas(header, first, {new_first.ptr, false, next_tag(first.tag)});
+            instr.cas(moved);
+            if (!moved)
+                return;
+            while (first.ptr != new_first.ptr)
+            {
+                Link next = load(first.ptr->next);
+                freelists[tid].push(first.ptr);
+                first = next;
+            }
+        }
+
+    public:
+        explicit BasicQueue(Backoff backoff_policy = Backoff{}) : manager(backoff_policy)
+        {
+            Node *h = new Node;
+            h->next.store(nullptr, 0, std::memory_order_relaxed);
+            h->value = empty_val;
+
+            header.store(h, 0, std::memory_order_relaxed);
+            tail.store(h, 0, std::memory_order_relaxed);
+
+            int n_threads = omp_get_max_threads();
+            freelists.resize(n_threads);
+        }
+
+        ~BasicQueue()
+        {
+            Node *walker = header.getPointer(std::memory_order_relaxed);
+            while (walker)
+            {
+                Node *current = walker;
+                walker = walker->next.getPointer(std::memory_order_relaxed);
+                delete current;
+            }
+        }
+
+        BasicQueue(const BasicQueue &) = delete;
+        BasicQueue(BasicQueue &&) = delete;
+        BasicQueue &operator=(const BasicQueue &) = delete;
+        BasicQueue &operator=(BasicQueue &&) = delete;
+
+        bool push(value_t val) override
+        {
+            int tid = omp_get_thread_num();
+
+            Node *n = freelists[tid].get();
+            instr.freelist(n != nullptr);
+            if (n == nullptr)
+                n = freelists[tid].allocate();
+            n->value = val;
+            messages.write(n->payload, val);
+
+            unsigned attempts = 0;
+            while (true)
+            {
+                Link last = load(tail);
+                Link next = load(last.ptr->next);
+                if (!(load(tail) == last))
+                    continue;
+
+                if (next.ptr != nullptr)
+                {
+                    // Tail is lagging, find the last node and help advance it
+                    while (load(next.ptr->next).ptr != nullptr && load(tail) == last)
+                        next = load(next.ptr->next);
+                    fix_tail(last, next);
+                    continue;
+                }
+
+                store(n->next, {nullptr, false, next_tag(last.tag, 2)});
+                bool linked = cas(last.ptr->next, next, {n, false, next_tag(last.tag)});
+                instr.cas(linked);
+                if (linked)
+                {
+                    instr.cas(cas(tail, last, {n, false, next_tag(last.tag)}));
+                    tracker.pushed();
+                    return true;
+                }
+
+                // Lost against a concurrent push: join its basket behind the old tail
+                next = load(last.ptr->next);
+                while (next.tag == next_tag(last.tag) && !next.deleted)
+                {
+                    manager.failed(attempts);
+                    store(n->next, next);
+                    bool in_basket = cas(last.ptr->next, next, {n, false, next_tag(last.tag)});
+                    instr.cas(in_basket);
+                    if (in_basket)
+                    {
+                        tracker.pushed();
+                        return true;
+                    }
+                    next = load(last.ptr->next);
+                }
+            }
+        }
+
+        value_t pop() override
+        {
+            int tid = omp_get_thread_num();
+
+            unsigned attempts = 0;
+            while (true)
+            {
+                Link first = load(header);
+                Link last = load(tail);
+                Link next = load(first.ptr->next);
+                if (!(load(header) == first))
+                    continue;
+
+                if (first.ptr == last.ptr)
+                {
+                    if (next.ptr == nullptr)
+                        return empty_val;
+                    while (load(next.ptr->next).ptr != nullptr && load(tail) == last)
+                        next = load(next.ptr->next);
+                    fix_tail(last, next);
+                    continue;
+                }
+
+                // Skip the nodes that are popped but not unlinked yet
+                Link iter = first;
+                unsigned hops = 0;
+                while (next.deleted && iter.ptr != last.ptr && load(header) == first)
+                {
+                    iter = next;
+                    next = load(iter.ptr->next);
+                    ++hops;
+                }
+                if (!(load(header) == first))
+                    continue;
+                if (iter.ptr == last.ptr)
+                {
+                    free_chain(tid, first, iter);
+                    continue;
+                }
+                if (next.ptr == nullptr)
+                    continue; // read a recycled node
+
+                value_t val = next.ptr->value;
+                auto taken = messages.take(next.ptr->payload);
+                if (!(load(header) == first))
+                    continue; // iter may have been recycled while we read
+                bool unlinked = cas(iter.ptr->next, next, {next.ptr, true, next_tag(next.tag)});
+                instr.cas(unlinked);
+                if (unlinked)
+                {
+                    if (hops >= max_hops)
+                        free_chain(tid, first, next);
+                    tracker.popped();
+                    messages.consume(taken);
+                    return val;
+                }
+                manager.failed(attempts);
+            }
+        }
+
+        int get_size() override
+        {
+            return tracker.get();
+        }
+
+        std::optional<instrumentation::Contention> contention() const override { return instr.contention(); }
+        void reset_contention() override { instr.reset(); }
+
+        // Popped nodes still linked before the head count as neither free nor queued
+        std::optional<memory::Allocation> allocation() const override
+        {
+            memory::Allocation to_rtn{sizeof(Node), 1, {}, // the dummy node
+                                      messages.buffer_bytes(), messages.buffers_allocated()};
+            for (auto const &f : freelists)
+            {
+                to_rtn.nodes_allocated += f.getAllocated();
+                to_rtn.free_nodes.push_back(f.getSize());
+            }
+            return to_rtn;
+        }
+    };
+
+    using Queue = BasicQueue<>;
+}; // namespace baskets
@@ -1,17 +1,37 @@
 #pragma once
 #include "lock_guard.hpp"
 #include "sequential.hpp"
-#include "lock_free_aba.hpp"
+#include "affinity.hpp"
+#include "backoff.hpp"
+#include "history.hpp"
+#include "host_info.hpp"
+#include "hwbench.hpp"
+#include "json.hpp"
+#include "instrumentation.hpp"
+#include "latency.hpp"
+#include "memory.hpp"
+#include "payload.hpp"
+#include "perf_counters.hpp"
+#include "sequence_check.hpp"
+#include "sizing.hpp"
+#include "statistics.hpp"
+#include "telemetry.hpp"
+#include "trace.hpp"
 #include <algorithm>
 #include <array>
 #include <atomic>
 #include <cassert>
+#include <chrono>
 #include <filesystem>
+#include <fstream>
 #include <iostream>
+#include <map>
+#include <optional>
 #include <random>
+#include <span>
 #include <utility>
 
-using value_t = int;
+using value_t = generics::value_t;
 
 enum class ConfigRecipe
 {
@@ -19,15 +39,47 @@ enum class ConfigRecipe
     ThreadSpecific
 };
 
+inline std::string to_string(ConfigRecipe recipe)
+{
+    switch (recipe)
+    {
+    case ConfigRecipe::Balanced:
+        return "balanced";
+    case ConfigRecipe::ThreadSpecific:
+        return "thread";
+    }
+    return "unknown";
+}
+
 struct Config
 {
     size_t num_threads;
     size_t repetitions;
     int max_time_in_s;
+    double warmup_time_in_s{}; // excluded from the results
     size_t sets;
     int seed;
+    ConfigRecipe recipe{ConfigRecipe::Balanced};
+    bool perf_counters{false}; // hardware counters around the timed region
+    bool verify{false};        // per producer sequence verification in run_fast
     std::vector<int> batch_enque; // per thread batch
     std::vector<int> batch_deque; // per thread batch
+    affinity::Placement placement{affinity::Placement::None};
+    std::vector<int> cpu_list; // only used with Placement::List
+    double telemetry_interval_ms{}; // 0 disables the time series sampler
+    size_t telemetry_capacity{4096}; // samples kept per repetition
+    size_t latency_sample{}; // time every n-th operation of a thread, 0 disables
+    backoff::Kind backoff{backoff::Kind::None}; // of the queue, only recorded
+    backoff::Parameters backoff_parameters{};
+    size_t payload_bytes{}; // message per element (payload.hpp), 0 for the value only
+    payload::Mode payload_mode{payload::Mode::Inline};
+    sizing::Kind size_tracking{sizing::Kind::Shared}; // of the queue, only recorded
+
+    // Bytes one push or pop moves
+    size_t message_bytes() const
+    {
+        return payload_bytes != 0 ? payload_bytes : sizeof(generics::value_t);
+    }
 
     bool is_config_correct()
     {
@@ -53,12 +105,42 @@ struct Config
             return false;
         }
 
+        if (placement == affinity::Placement::List && cpu_list.empty())
+        {
+            std::cout << "List placement needs a list of cpus" << std::endl;
+            return false;
+        }
+
+        if (warmup_time_in_s < 0 || warmup_time_in_s > 100)
+        {
+            std::cout << "Warm-up specification is not reasonable" << std::endl;
+            return false;
+        }
+
+        if (telemetry_interval_ms < 0 || (telemetry_interval_ms > 0 && telemetry_capacity == 0))
+        {
+            std::cout << "Telemetry specification is not reasonable" << std::endl;
+            return false;
+        }
+
         if (sets == 0 && max_time_in_s == 0)
         {
             std::cout << "Either you need to specify a time based benchmark or a set based benchmark" << std::endl;
             return false;
         }
 
+        if (!backoff_parameters.valid())
+        {
+            std::cout << "Backoff needs 0 < min_spins <= max_spins" << std::endl;
+            return false;
+        }
+
+        if (!payload::supported(payload_bytes))
+        {
+            std::cout << "Payload size is not instantiated, see payload::sizes" << std::endl;
+            return false;
+        }
+
         if (repetitions > 100)
         {
             std::cout << "Repetition specification seems irresonable"
@@ -79,12 +161,14 @@ private:
     int sets;
     int seed;
     ConfigRecipe config_recipe;
+    int batch_size; // 0 keeps the default of the recipe
 
 public:
     ConfigFactory(int num_threads, int repetitions, int max_time_in_s, int sets, int seed,
-                  ConfigRecipe config_recipe)
+                  ConfigRecipe config_recipe, int batch_size = 0)
         : num_threads(num_threads), repetitions(repetitions),
-          max_time_in_s(max_time_in_s), sets(sets), seed(seed), config_recipe(config_recipe)
+          max_time_in_s(max_time_in_s), sets(sets), seed(seed), config_recipe(config_recipe),
+          batch_size(batch_size)
     {
     }
 
@@ -94,14 +178,17 @@ public:
         to_rtn.num_threads = num_threads;
         to_rtn.repetitions = repetitions;
         to_rtn.max_time_in_s = max_time_in_s;
+        to_rtn.sets = sets;
         to_rtn.seed = seed;
+        to_rtn.recipe = config_recipe;
 
         switch (config_recipe)
         {
         case ConfigRecipe::Balanced:
         {
-            to_rtn.batch_enque.resize(num_threads, 4096);
-            to_rtn.batch_deque.resize(num_threads, 4096);
+            int batch = batch_size > 0 ? batch_size : 4096;
+            to_rtn.batch_enque.resize(num_threads, batch);
+            to_rtn.batch_deque.resize(num_threads, batch);
             break;
         }
 
@@ -111,15 +198,16 @@ public:
             to_rtn.batch_deque.resize(num_threads, 0);
 
             int half_threads = num_threads / 2;
+            int batch = batch_size > 0 ? batch_size : 128;
 
             for (int i = 0; i < half_threads; ++i)
-                to_rtn.batch_enque[i] = 128;
+                to_rtn.batch_enque[i] = batch;
 
             for (int i = half_threads; i < num_threads; ++i)
-                to_rtn.batch_deque[i] = 128;
+                to_rtn.batch_deque[i] = batch;
 
-            if (num_threads % 2 != 0)
-                to_rtn.batch_enque[half_threads - 1] = 128;
+            if (num_threads % 2 != 0 && num_threads > 1)
+                to_rtn.batch_enque[half_threads - 1] = batch;
 
             break;
         }
@@ -142,10 +230,11 @@ struct Counter
     size_t succeeded_pop{};
     size_t total_push{};
     size_t total_pop{};
-    value_t sum_of_pushed_values{};
-    value_t sum_of_poped_values{};
     double time{};
     double timeout{};
+    perf::Counts perf{};
+    latency::Histogram push_latency{}; // only with config.latency_sample
+    latency::Histogram pop_latency{};
 };
 
 void reset_counter(Counter &counter)
@@ -155,12 +244,34 @@ void reset_counter(Counter &counter)
     counter.succeeded_pop = 0;
     counter.total_push = 0;
     counter.total_pop = 0;
-    counter.sum_of_pushed_values = 0;
-    counter.sum_of_poped_values = 0;
     counter.time = 0.0;
     counter.timeout = 0.0;
+    counter.perf = perf::Counts{};
+    counter.push_latency = latency::Histogram{};
+    counter.pop_latency = latency::Histogram{};
 }
 
+// One repetition, summed over all threads
+struct Sample
+{
+    double time{};
+    double timeout{};
+
+    size_t n_operations{};
+    size_t succeded_enqueues{};
+    size_t succeded_dequeues{};
+
+    size_t enqueues{};
+    size_t dequeues{};
+
+    double throughput{}; // operations per second
+    double fairness{1.0}; // Jain index of the per thread operations
+    perf::Counts perf{};
+
+    std::vector<Counter> threads; // per thread counters of this repetition
+    telemetry::Series telemetry;  // empty unless config.telemetry_interval_ms
+};
+
 struct Results
 {
     double avg_time{};
@@ -172,86 +283,270 @@ struct Results
 
     size_t total_enqueues{};
     size_t total_dequeues{};
+
+    std::vector<Sample> samples; // one per repetition
+    stats::Statistics throughput{};
+    double fairness{1.0}; // mean over the repetitions
+
+    // Hardware counters per operation, only meaningful where perf_valid
+    std::array<double, perf::N_EVENTS> perf_per_op{};
+    std::array<bool, perf::N_EVENTS> perf_valid{};
+
+    // Summed over the repetitions, only for instrumented queues
+    std::optional<instrumentation::Contention> contention;
+
+    // Summed over threads and repetitions
+    latency::Histogram push_latency{};
+    latency::Histogram pop_latency{};
+
+    // At the end of the run, allocation only for queues that track it
+    std::optional<memory::Allocation> allocation;
+    memory::Rss rss{};
 };
 
 void update_results(Results &res, std::vector<Counter> const &counters)
 {
-    res.total_n_operations = std::accumulate(
-        counters.begin(), counters.end(), 0,
-        [](size_t sum, Counter const &c)
-        { return sum + c.total_operations; });
-
-    res.total_succeded_enqueues = std::accumulate(
-        counters.begin(), counters.end(), 0,
-        [](size_t sum, Counter const &c)
-        { return sum + c.succeeded_push; });
-
-    res.total_succeded_dequeues = std::accumulate(
-        counters.begin(), counters.end(), 0,
-        [](size_t sum, Counter const &c)
-        { return sum + c.succeeded_pop; });
-
-    res.total_enqueues = std::accumulate(counters.begin(), counters.end(), 0,
-                                         [](size_t sum, Counter const &c)
-                                         { return sum + c.total_push; });
-
-    res.total_dequeues = std::accumulate(counters.begin(), counters.end(), 0,
-                                         [](size_t sum, Counter const &c)
-                                         { return sum + c.total_pop; });
-
-    double total_time = std::accumulate(counters.begin(), counters.end(), 0.0,
-                                        [](double sum, Counter const &c)
-                                        { return sum + c.time; });
-
-    double total_timeout = std::accumulate(counters.begin(), counters.end(), 0.0,
-                                           [](double sum, Counter const &c)
-                                           { return sum + c.timeout; });
-    res.avg_time = counters.empty() ? 0.0 : total_time / counters.size();
-    res.avg_timeout = counters.empty() ? 0.0 : total_timeout / counters.size();
+    Sample sample{};
+    sample.perf.valid.fill(!counters.empty());
+    for (auto const &c : counters)
+    {
+        perf::accumulate(sample.perf, c.perf);
+        sample.n_operations += c.total_operations;
+        sample.succeded_enqueues += c.succeeded_push;
+        sample.succeded_dequeues += c.succeeded_pop;
+        sample.enqueues += c.total_push;
+        sample.dequeues += c.total_pop;
+        sample.time += c.time;
+        sample.timeout += c.timeout;
+    }
+
+    if (!counters.empty())
+    {
+        sample.time /= counters.size();
+        sample.timeout /= counters.size();
+    }
+
+    double t_eff = sample.time - sample.timeout;
+    sample.throughput = t_eff > 0.0 ? sample.n_operations / t_eff : 0.0;
+
+    std::vector<double> shares;
+    shares.reserve(counters.size());
+    for (auto const &c : counters)
+        shares.push_back(double(c.total_operations));
+    sample.fairness = stats::jain(shares);
+
+    sample.threads = counters;
+    res.samples.push_back(sample);
+}
+
+void calc_results(Results &res, Config const &)
+{
+    size_t repetitions = res.samples.size();
+    if (repetitions == 0)
+        return;
+
+    Sample sum{};
+    sum.perf.valid.fill(true);
+    res.fairness = 0.0;
+    std::vector<double> throughputs;
+    throughputs.reserve(repetitions);
+
+    for (auto const &s : res.samples)
+    {
+        sum.time += s.time;
+        sum.timeout += s.timeout;
+        sum.n_operations += s.n_operations;
+        sum.succeded_enqueues += s.succeded_enqueues;
+        sum.succeded_dequeues += s.succeded_dequeues;
+        sum.enqueues += s.enqueues;
+        sum.dequeues += s.dequeues;
+        throughputs.push_back(s.throughput);
+        res.fairness += s.fairness;
+        perf::accumulate(sum.perf, s.perf);
+        for (auto const &c : s.threads)
+        {
+            res.push_latency += c.push_latency;
+            res.pop_latency += c.pop_latency;
+        }
+    }
+
+    res.fairness /= double(repetitions);
+    res.avg_time = sum.time / repetitions;
+    res.avg_timeout = sum.timeout / repetitions;
+    res.total_n_operations = sum.n_operations / repetitions;
+    res.total_succeded_enqueues = sum.succeded_enqueues / repetitions;
+    res.total_succeded_dequeues = sum.succeded_dequeues / repetitions;
+    res.total_enqueues = sum.enqueues / repetitions;
+    res.total_dequeues = sum.dequeues / repetitions;
+
+    res.throughput = stats::describe(std::move(throughputs));
+
+    for (int e = 0; e < perf::N_EVENTS; ++e)
+    {
+        res.perf_valid[e] = sum.perf.valid[e] && sum.n_operations > 0;
+        res.perf_per_op[e] = res.perf_valid[e]
+                                 ? double(sum.perf.values[e]) / sum.n_operations
+                                 : 0.0;
+    }
 }
 
-void calc_results(Results &res, Config const &config)
+// Batch of the values 0..N-1 in random order
+std::vector<value_t> generate_batch(uint N, std::mt19937 &rng)
 {
-    int repetitions = config.repetitions;
-
-    res.avg_time /= repetitions;
-    res.avg_timeout /= repetitions;
-    res.total_n_operations /= repetitions;
-    res.total_dequeues /= repetitions;
-    res.total_enqueues /= repetitions;
-    res.total_succeded_dequeues /= repetitions;
-    res.total_succeded_enqueues /= repetitions;
+    std::vector<value_t> to_rtn(N);
+    std::iota(to_rtn.begin(), to_rtn.end(), static_cast<value_t>(0));
+    std::shuffle(to_rtn.begin(), to_rtn.end(), rng);
+    return to_rtn;
 }
 
+// Push batches generated once up front and shared by many benchmarks, e.g.
+// by a sweep. Thread t with batch size N gets the same batch the Benchmark
+// would generate itself for the same seed. Read only while benchmarks run.
+class InputPool
+{
+    std::map<std::pair<uint, uint>, std::vector<value_t>> batches;
+
+public:
+    InputPool(int seed, uint max_threads, std::vector<uint> const &batch_sizes)
+    {
+        for (uint thread_id = 0; thread_id < max_threads; ++thread_id)
+        {
+            for (uint batch_size : batch_sizes)
+            {
+                std::mt19937 thread_rng(seed + thread_id + 1);
+                batches[{thread_id, batch_size}] = generate_batch(batch_size, thread_rng);
+            }
+        }
+    }
+
+    std::vector<value_t> const *find(uint thread_id, uint batch_size) const
+    {
+        auto it = batches.find({thread_id, batch_size});
+        return it == batches.end() ? nullptr : &it->second;
+    }
+};
+
 class Benchmark
 {
 private:
     Config config;
     std::vector<Counter> counters; // for each thread one
     Results results{};
-    bool verify_correctness(std::vector<Counter> const &counters,
-                            value_t leftovers)
+    std::vector<int> cpus; // placement order, empty means no pinning
+    InputPool const *inputs = nullptr;
+    hwbench::Characterization const *hardware = nullptr;
+    sequence_check::Report verification{}; // summed over the repetitions
+
+    void place_thread(uint thread_id)
     {
-        value_t total_pushed = 0;
-        value_t total_popped = 0;
+        if (cpus.empty())
+            return;
+        if (!affinity::pin_current_thread(cpus[thread_id % cpus.size()]))
+            std::cerr << "Could not pin thread " << thread_id << std::endl;
+    }
 
-        for (auto const &c : counters)
-        {
-            total_pushed += c.sum_of_pushed_values;
-            total_popped += c.sum_of_poped_values;
-        }
+    // Opens the hardware counters of the calling thread if requested. Thread 0
+    // warns once per run if the kernel does not hand out any counter.
+    void open_perf_counters(std::optional<perf::ThreadCounters> &hw,
+                            uint thread_id, size_t repetition)
+    {
+        if (!config.perf_counters)
+            return;
 
-        return total_pushed == (total_popped + leftovers);
+        hw.emplace();
+        if (thread_id == 0 && repetition == 0 && !hw->any_available())
+            std::cerr << "perf_event_open is not available, hardware counters are reported as NA"
+                      << std::endl;
     }
 
     std::vector<value_t> generate_batch_of_elements(uint N, std::mt19937 &rng)
     {
-        std::vector<value_t> to_rtn(N);
-        std::iota(to_rtn.begin(), to_rtn.end(), static_cast<value_t>(0));
-        std::shuffle(to_rtn.begin(), to_rtn.end(), rng);
-        return to_rtn;
+        return generate_batch(N, rng);
     };
 
+    // The pre generated batch if an input pool was handed in, otherwise a
+    // freshly generated one kept alive in storage.
+    std::vector<value_t> const &thread_inputs(uint thread_id, uint batch_size,
+                                              std::mt19937 &rng,
+                                              std::vector<value_t> &storage)
+    {
+        if (inputs != nullptr)
+        {
+            if (auto const *batch = inputs->find(thread_id, batch_size))
+                return *batch;
+        }
+        storage = generate_batch_of_elements(batch_size, rng);
+        return storage;
+    }
+
+    // Runs the push/pop loop for config.warmup_time_in_s without touching the
+    // counters. Faults in the pages and populates the free lists so that the
+    // first repetition is not penalised.
+    // Time series sampler of one repetition, only with telemetry enabled
+    void open_recorder(std::optional<telemetry::Recorder> &recorder, BaseQueue &queue)
+    {
+        if (config.telemetry_interval_ms > 0)
+            recorder.emplace(queue, config.num_threads, config.telemetry_interval_ms,
+                             config.telemetry_capacity);
+    }
+
+    // Allocation state and RSS after the repetition that just finished, the
+    // last repetition's values are the ones of the run
+    void add_memory(BaseQueue const &queue)
+    {
+        results.allocation = queue.allocation();
+        results.rss = memory::read_rss();
+    }
+
+    // Over all repetitions, the contention counters are summed over them
+    double cas_per_op() const
+    {
+        if (!results.contention)
+            return -1.0;
+        return instrumentation::cas_per_op(*results.contention,
+                                           uint64_t(results.total_n_operations * results.samples.size()));
+    }
+
+    // Adds the counters of the repetition that just finished
+    void add_contention(BaseQueue const &queue)
+    {
+        auto c = queue.contention();
+        if (!c)
+            return;
+        if (!results.contention)
+            results.contention = instrumentation::Contention{};
+        *results.contention += *c;
+    }
+
+    void warm_up(BaseQueue &queue)
+    {
+        if (config.warmup_time_in_s <= 0.0)
+            return;
+
+#pragma omp parallel num_threads(config.num_threads)
+        {
+            uint thread_id = omp_get_thread_num();
+            place_thread(thread_id);
+            uint enqueue_batch_size = config.batch_enque[thread_id];
+            uint dequeue_batch_size = config.batch_deque[thread_id];
+            std::mt19937 thread_rng(config.seed + thread_id + 1);
+
+            std::vector<value_t> storage;
+            std::vector<value_t> const &push_elements =
+                thread_inputs(thread_id, enqueue_batch_size, thread_rng, storage);
+#pragma omp barrier
+            double t_start = omp_get_wtime();
+            while (omp_get_wtime() - t_start < config.warmup_time_in_s)
+            {
+                for (size_t i = 0; i < enqueue_batch_size; i++)
+                    queue.push(push_elements[i]);
+
+                for (size_t i = 0; i < dequeue_batch_size; i++)
+                    queue.pop();
+            }
+        } // End parallel
+    }
+
 public:
     Benchmark(Config &&cfg) : config(std::move(cfg))
     {
@@ -261,204 +556,326 @@ public:
                       << std::endl;
             std::abort();
         }
+        cpus = affinity::cpu_order(config.placement, config.cpu_list);
     };
 
-    void run_safe(BaseQueue &queue)
-    {
-        std::mt19937 global_rng(config.seed);
+    // Pre generated inputs, must outlive the runs of this benchmark
+    void set_inputs(InputPool const *pool) { inputs = pool; }
 
+    // Measured once per process (hwbench.hpp), stored with every record
+    void set_hardware(hwbench::Characterization const *hw) { hardware = hw; }
+
+    // Records a timestamped invoke/response history of every operation and
+    // checks it for linearizability once all threads are done (history.hpp).
+    // capacity is the number of operations each thread can record, a thread
+    // stops early once its buffer is full. Pushed values are unique.
+    history::Report run_history(BaseQueue &queue, size_t capacity)
+    {
         counters.resize(config.num_threads);
+        results = Results{};
+        history::Report report{};
+
+        std::vector<history::ThreadHistory> histories;
+        histories.reserve(config.num_threads + 1);
+        for (size_t t = 0; t < config.num_threads; ++t)
+            histories.emplace_back(capacity);
+
+        warm_up(queue);
+        count_leftovers_n_empty(queue); // warm-up values are not unique
 
         for (size_t i = 0; i < config.repetitions; i++)
         {
 #pragma omp parallel num_threads(config.num_threads)
             {
                 uint thread_id = omp_get_thread_num();
+                place_thread(thread_id);
                 Counter &l_counter = counters[thread_id];
                 reset_counter(l_counter);
+                history::ThreadHistory &h = histories[thread_id];
+                h.clear();
 
                 uint enqueue_batch_size = config.batch_enque[thread_id];
                 uint dequeue_batch_size = config.batch_deque[thread_id];
-                std::mt19937 thread_rng(config.seed + thread_id + 1);
-                double timeout = 0.0;
-
+                uint64_t sequence = 0;
+#pragma omp barrier
                 double t_start = omp_get_wtime();
-                while (omp_get_wtime() - t_start < config.max_time_in_s)
+                while (omp_get_wtime() - t_start < config.max_time_in_s && !h.full())
                 {
-                    double t0 = omp_get_wtime();
-                    std::vector<value_t> push_elements =
-                        generate_batch_of_elements(enqueue_batch_size,
-                                                   thread_rng);
-                    double t1 = omp_get_wtime();
-                    timeout += t1 - t0;
-
-                    for (size_t i = 0; i < enqueue_batch_size; i++)
+                    for (size_t j = 0; j < enqueue_batch_size && !h.full(); j++)
                     {
-                        value_t tmp = push_elements[i];
-
-                        if (queue.push(tmp))
+                        value_t v = generics::encode(thread_id, sequence++);
+                        int64_t t0 = history::now();
+                        bool pushed = queue.push(v);
+                        int64_t t1 = history::now();
+                        if (pushed)
                         {
-                            l_counter.sum_of_pushed_values += tmp;
+                            h.record(history::Op::Push, v, t0, t1);
                             l_counter.succeeded_push++;
-                        };
+                        }
                         l_counter.total_push++;
                     }
 
-                    t0 = omp_get_wtime();
-                    std::vector<value_t> poped_elements;
-                    poped_elements.reserve(dequeue_batch_size);
-                    t1 = omp_get_wtime();
-                    timeout += t1 - t0;
-
-                    for (size_t i = 0; i < dequeue_batch_size; i++)
+                    for (size_t j = 0; j < dequeue_batch_size && !h.full(); j++)
                     {
-                        value_t tmp = queue.pop();
-                        if (tmp != generics::empty_val)
-                        {
-                            l_counter.sum_of_poped_values += tmp;
+                        int64_t t0 = history::now();
+                        value_t v = queue.pop();
+                        int64_t t1 = history::now();
+                        h.record(history::Op::Pop, v, t0, t1);
+                        if (v != generics::empty_val)
                             l_counter.succeeded_pop++;
-                        }
                         l_counter.total_pop++;
                     }
                 }
                 double t_end = omp_get_wtime();
+
                 l_counter.total_operations =
                     l_counter.total_pop + l_counter.total_push;
-
                 l_counter.time += t_end - t_start;
-                l_counter.timeout += timeout;
-
             } // End parallel
-#pragma omp barrier
-            value_t leftovers = count_leftovers_n_empty(queue);
-            if (!verify_correctness(counters, leftovers))
-                std::cerr << "Something went terribly wrong" << std::endl;
+
+            // The leftovers are popped after every other operation returned.
+            // Without size tracking (-1) any recorded operation may have left one.
+            int left = queue.get_size();
+            size_t bound = 0;
+            if (left >= 0)
+                bound = size_t(left);
+            else
+                for (auto const &h : histories)
+                    bound += h.size();
+            history::ThreadHistory drain(bound + 1);
+            while (!drain.full())
+            {
+                int64_t t0 = history::now();
+                value_t v = queue.pop();
+                int64_t t1 = history::now();
+                if (v == generics::empty_val)
+                    break;
+                drain.record(history::Op::Pop, v, t0, t1);
+            }
+            histories.push_back(std::move(drain));
+            report += history::check(histories);
+            histories.pop_back();
 
             update_results(results, counters);
         } // End for loop repetition
 
         calc_results(results, config);
+        return report;
     }
 
-    value_t count_leftovers_n_empty(BaseQueue &queue)
+    // Replays a trace (trace.hpp): thread t of the team runs the records of
+    // thread t of the trace straight from the mapping. Every repetition is
+    // one pass over the trace, cut at max_time_in_s. With honour_gaps the
+    // recorded inter-arrival gaps are reproduced by spinning.
+    void run_replay(BaseQueue &queue, trace::Mapped const &trace, bool honour_gaps)
     {
-        value_t leftovers = 0;
-
-        while (true)
-        {
-            value_t tmp = queue.pop();
-            if (tmp != generics::empty_val)
-            {
-                leftovers += tmp;
-            }
-            else
-            {
-                break;
-            }
-        }
-
-        return leftovers;
-    }
-
-    void run_fast(BaseQueue &queue)
-    {
-        std::mt19937 global_rng(config.seed);
+        assert(trace.n_threads() == config.num_threads);
+        constexpr size_t check_every = 1024; // records between clock reads
 
         counters.resize(config.num_threads);
+        results = Results{};
+        memory::reset_peak_rss();
 
         for (size_t i = 0; i < config.repetitions; i++)
         {
+            queue.reset_contention();
+            std::optional<telemetry::Recorder> recorder;
+            open_recorder(recorder, queue);
 #pragma omp parallel num_threads(config.num_threads)
             {
                 uint thread_id = omp_get_thread_num();
+                place_thread(thread_id);
                 Counter &l_counter = counters[thread_id];
                 reset_counter(l_counter);
+                std::optional<perf::ThreadCounters> hw;
+                open_perf_counters(hw, thread_id, i);
 
-                uint enqueue_batch_size = config.batch_enque[thread_id];
-                uint dequeue_batch_size = config.batch_deque[thread_id];
-                std::mt19937 thread_rng(config.seed + thread_id + 1);
-                double timeout = 0.0;
-
-                std::vector<value_t> push_elements =
-                    generate_batch_of_elements(enqueue_batch_size,
-                                               thread_rng);
+                std::span<trace::Record const> records = trace.thread(thread_id);
+                auto issued = std::chrono::steady_clock::now();
 #pragma omp barrier
+                if (recorder && thread_id == 0)
+                    recorder->start();
+                if (hw)
+                    hw->start();
                 double t_start = omp_get_wtime();
-                while (omp_get_wtime() - t_start < config.max_time_in_s)
+                for (size_t j = 0; j < records.size(); ++j)
                 {
+                    trace::Record const &r = records[j];
+                    if (honour_gaps && r.gap_ns != 0)
+                    {
+                        auto target = issued + std::chrono::nanoseconds(r.gap_ns);
+                        while (std::chrono::steady_clock::now() < target)
+                            ;
+                    }
+                    if (honour_gaps)
+                        issued = std::chrono::steady_clock::now();
 
-                    for (size_t i = 0; i < enqueue_batch_size; i++)
+                    if (r.op == trace::Op::Push)
                     {
-                        if (queue.push(push_elements[i]))
+                        if (queue.push(r.value))
                             l_counter.succeeded_push++;
+                        l_counter.total_push++;
                     }
-                    l_counter.total_push += enqueue_batch_size;
-
-                    for (size_t i = 0; i < dequeue_batch_size; i++)
+                    else
                     {
                         if (queue.pop() != generics::empty_val)
                             l_counter.succeeded_pop++;
+                        l_counter.total_pop++;
+                    }
+
+                    if (j % check_every == check_every - 1)
+                    {
+                        if (recorder)
+                            recorder->publish(thread_id, l_counter.total_push + l_counter.total_pop);
+                        if (omp_get_wtime() - t_start >= config.max_time_in_s)
+                            break;
                     }
-                    l_counter.total_pop += dequeue_batch_size;
                 }
                 double t_end = omp_get_wtime();
+                if (hw)
+                {
+                    hw->stop();
+                    l_counter.perf = hw->read_counts();
+                }
 #pragma omp barrier
 
                 l_counter.total_operations =
                     l_counter.total_pop + l_counter.total_push;
                 l_counter.time += t_end - t_start;
-                l_counter.timeout += timeout;
-
             } // End parallel
+            telemetry::Series series;
+            if (recorder)
+                series = recorder->finish();
+            add_contention(queue);
+            add_memory(queue);
 
             update_results(results, counters);
+            results.samples.back().telemetry = std::move(series);
         } // End for loop repetition
 
         calc_results(results, config);
     }
 
-    void run_sets(BaseQueue &queue)
+    value_t count_leftovers_n_empty(BaseQueue &queue)
+    {
+        value_t leftovers = 0;
+
+        while (true)
+        {
+            value_t tmp = queue.pop();
+            if (tmp != generics::empty_val)
+            {
+                leftovers += tmp;
+            }
+            else
+            {
+                break;
+            }
+        }
+
+        return leftovers;
+    }
+
+    // Pushes the pre generated batch over and over. With config.verify every
+    // pushed value is unique and every pop is checked (sequence_check.hpp).
+    void run_fast(BaseQueue &queue)
+    {
+        if (config.verify)
+            run_fast_impl<true>(queue);
+        else
+            run_fast_impl<false>(queue);
+    }
+
+    template <bool verify>
+    void run_fast_impl(BaseQueue &queue)
     {
-        std::mt19937 global_rng(config.seed);
         counters.resize(config.num_threads);
+        results = Results{};
+        memory::reset_peak_rss();
+        verification = sequence_check::Report{};
+
+        warm_up(queue);
+        if constexpr (verify)
+            count_leftovers_n_empty(queue); // warm-up values are not unique
 
         for (size_t i = 0; i < config.repetitions; i++)
         {
+            std::optional<sequence_check::Verifier> verifier;
+            if constexpr (verify)
+                verifier.emplace(config.num_threads);
+            queue.reset_contention();
+            std::optional<telemetry::Recorder> recorder;
+            open_recorder(recorder, queue);
+
 #pragma omp parallel num_threads(config.num_threads)
             {
                 uint thread_id = omp_get_thread_num();
+                place_thread(thread_id);
                 Counter &l_counter = counters[thread_id];
                 reset_counter(l_counter);
+                std::optional<perf::ThreadCounters> hw;
+                open_perf_counters(hw, thread_id, i);
 
                 uint enqueue_batch_size = config.batch_enque[thread_id];
                 uint dequeue_batch_size = config.batch_deque[thread_id];
                 std::mt19937 thread_rng(config.seed + thread_id + 1);
                 double timeout = 0.0;
 
-                std::vector<value_t> push_elements =
-                    generate_batch_of_elements(enqueue_batch_size,
-                                               thread_rng);
-                assert(config.sets != 0);
+                std::vector<value_t> storage;
+                std::vector<value_t> const &push_elements =
+                    thread_inputs(thread_id, enqueue_batch_size, thread_rng, storage);
+                latency::Sampler timed(config.latency_sample);
 #pragma omp barrier
+                if (recorder && thread_id == 0)
+                    recorder->start();
+                if (hw)
+                    hw->start();
                 double t_start = omp_get_wtime();
-                for (size_t i{0}; i < config.sets; ++i)
+                while (omp_get_wtime() - t_start < config.max_time_in_s)
                 {
 
-                    for (size_t i = 0; i < enqueue_batch_size; i++)
+                    for (size_t j = 0; j < enqueue_batch_size; j++)
                     {
-                        queue.push(push_elements[i]);
+                        value_t v;
+                        if constexpr (verify)
+                        {
+                            if (!verifier->next_value(thread_id, v))
+                                break;
+                        }
+                        else
+                            v = push_elements[j];
+
+                        if (timed(l_counter.push_latency, [&]
+                                  { return queue.push(v); }))
+                        {
+                            l_counter.succeeded_push++;
+                            if constexpr (verify)
+                                verifier->pushed(thread_id);
+                        }
                     }
                     l_counter.total_push += enqueue_batch_size;
-                    l_counter.succeeded_push += enqueue_batch_size;
 
-                    for (size_t i = 0; i < dequeue_batch_size; i++)
+                    for (size_t j = 0; j < dequeue_batch_size; j++)
                     {
-                        queue.pop();
+                        value_t v = timed(l_counter.pop_latency, [&]
+                                          { return queue.pop(); });
+                        if (v != generics::empty_val)
+                        {
+                            l_counter.succeeded_pop++;
+                            if constexpr (verify)
+                                verifier->popped(thread_id, v);
+                        }
                     }
                     l_counter.total_pop += dequeue_batch_size;
-                    l_counter.succeeded_pop += enqueue_batch_size;
+                    if (recorder)
+                        recorder->publish(thread_id, l_counter.total_push + l_counter.total_pop);
                 }
                 double t_end = omp_get_wtime();
+                if (hw)
+                {
+                    hw->stop();
+                    l_counter.perf = hw->read_counts();
+                }
 #pragma omp barrier
 
                 l_counter.total_operations =
@@ -467,65 +884,106 @@ public:
                 l_counter.timeout += timeout;
 
             } // End parallel
+            telemetry::Series series;
+            if (recorder)
+                series = recorder->finish();
+            add_contention(queue);
+            add_memory(queue);
+
+            if constexpr (verify)
+            {
+                // Leftovers count as popped by thread 0, after all its pops
+                for (value_t v = queue.pop(); v != generics::empty_val; v = queue.pop())
+                    verifier->popped(0, v);
+                verification += verifier->report();
+            }
 
             update_results(results, counters);
+            results.samples.back().telemetry = std::move(series);
         } // End for loop repetition
 
         calc_results(results, config);
     }
 
-    lock_free_aba::CASCounter run_fast_cache_checks(lock_free_aba::Queue &queue)
+    sequence_check::Report const &get_verification() const { return verification; }
+
+    // Valid until the next run of this benchmark
+    Results const &get_results() const { return results; }
+    Config const &get_config() const { return config; }
+
+    // Contention counters of the timed repetitions, nullopt unless the queue
+    // was built with instrumentation::Counting
+    std::optional<instrumentation::Contention> const &get_contention() const
     {
-        std::mt19937 global_rng(config.seed);
-        std::vector<lock_free_aba::CASCounter> cas_counters;
+        return results.contention;
+    }
 
+    void run_sets(BaseQueue &queue)
+    {
+        std::mt19937 global_rng(config.seed);
         counters.resize(config.num_threads);
-        cas_counters.resize(config.num_threads);
+        results = Results{};
+        memory::reset_peak_rss();
+
+        warm_up(queue);
 
         for (size_t i = 0; i < config.repetitions; i++)
         {
+            queue.reset_contention();
+            std::optional<telemetry::Recorder> recorder;
+            open_recorder(recorder, queue);
 #pragma omp parallel num_threads(config.num_threads)
             {
                 uint thread_id = omp_get_thread_num();
+                place_thread(thread_id);
                 Counter &l_counter = counters[thread_id];
-                lock_free_aba::CASCounter &l_cas_counter = cas_counters[thread_id];
                 reset_counter(l_counter);
+                std::optional<perf::ThreadCounters> hw;
+                open_perf_counters(hw, thread_id, i);
 
                 uint enqueue_batch_size = config.batch_enque[thread_id];
                 uint dequeue_batch_size = config.batch_deque[thread_id];
                 std::mt19937 thread_rng(config.seed + thread_id + 1);
                 double timeout = 0.0;
 
-                std::vector<value_t> push_elements =
-                    generate_batch_of_elements(enqueue_batch_size,
-                                               thread_rng);
+                std::vector<value_t> storage;
+                std::vector<value_t> const &push_elements =
+                    thread_inputs(thread_id, enqueue_batch_size, thread_rng, storage);
+                assert(config.sets != 0);
+                latency::Sampler timed(config.latency_sample);
 #pragma omp barrier
-                size_t SETS = 10;
+                if (recorder && thread_id == 0)
+                    recorder->start();
+                if (hw)
+                    hw->start();
                 double t_start = omp_get_wtime();
-                // while (omp_get_wtime() - t_start < config.max_time_in_s)
-                // {
-                for (size_t i{0}; i < SETS; ++i)
+                for (size_t i{0}; i < config.sets; ++i)
                 {
 
                     for (size_t i = 0; i < enqueue_batch_size; i++)
                     {
-                        // if (queue.push(push_elements[i]))
-                        //     l_counter.succeeded_push++;
-                        queue.pushb(push_elements[i], l_cas_counter);
+                        timed(l_counter.push_latency, [&]
+                              { return queue.push(push_elements[i]); });
                     }
                     l_counter.total_push += enqueue_batch_size;
                     l_counter.succeeded_push += enqueue_batch_size;
 
                     for (size_t i = 0; i < dequeue_batch_size; i++)
                     {
-                        queue.popb(l_cas_counter);
-                        // if (queue.pop() != generics::empty_val)
-                        //     l_counter.succeeded_pop++;
+                        timed(l_counter.pop_latency, [&]
+                              { return queue.pop(); });
                     }
                     l_counter.total_pop += dequeue_batch_size;
+                    if (recorder)
+                        recorder->publish(thread_id, l_counter.total_push + l_counter.total_pop);
                     l_counter.succeeded_pop += enqueue_batch_size;
                 }
                 double t_end = omp_get_wtime();
+                if (hw)
+                {
+                    hw->stop();
+                    l_counter.perf = hw->read_counts();
+                }
 #pragma omp barrier
 
                 l_counter.total_operations =
@@ -534,20 +992,17 @@ public:
                 l_counter.timeout += timeout;
 
             } // End parallel
+            telemetry::Series series;
+            if (recorder)
+                series = recorder->finish();
+            add_contention(queue);
+            add_memory(queue);
 
             update_results(results, counters);
+            results.samples.back().telemetry = std::move(series);
         } // End for loop repetition
 
         calc_results(results, config);
-
-        lock_free_aba::CASCounter total{};
-
-        total.success = std::accumulate(cas_counters.begin(), cas_counters.end(), 0, [](size_t sum, lock_free_aba::CASCounter const &a)
-                                        { return sum + a.success; });
-        total.failures = std::accumulate(cas_counters.begin(), cas_counters.end(), 0, [](size_t sum, lock_free_aba::CASCounter const &a)
-                                         { return sum + a.failures; });
-
-        return total;
     }
 
     void print_results() const
@@ -562,13 +1017,89 @@ public:
                   << results.total_succeded_dequeues << "\n";
         std::cout << "  Total enqueues: " << results.total_enqueues << "\n";
         std::cout << "  Total dequeues: " << results.total_dequeues << "\n";
+        std::cout << "  Throughput [ops/s]: " << results.throughput.mean
+                  << " +- " << results.throughput.ci95 << " (median "
+                  << results.throughput.median << ", stddev "
+                  << results.throughput.stddev << ", n = "
+                  << results.samples.size() << ")\n";
+        std::cout << "  Throughput [bytes/s]: " << results.throughput.mean * double(config.message_bytes())
+                  << " (" << config.message_bytes() << " byte messages"
+                  << (config.payload_bytes != 0 ? ", " + payload::to_string(config.payload_mode) : "") << ")\n";
+        std::cout << "  Fairness (Jain, per thread operations): " << results.fairness << "\n";
+        if (results.allocation)
+        {
+            auto const &a = *results.allocation;
+            std::cout << "  Nodes allocated: " << a.nodes_allocated << " of " << a.node_bytes
+                      << " bytes (" << a.nodes_allocated * a.node_bytes << " bytes), "
+                      << a.free_total() << " in free lists (max " << a.free_max() << " per thread)\n";
+            if (a.buffers_allocated != 0)
+                std::cout << "  Payload buffers allocated: " << a.buffers_allocated << " of "
+                          << a.buffer_bytes << " bytes\n";
+        }
+        std::cout << "  RSS peak / final [kB]: " << results.rss.peak_kb << " / "
+                  << results.rss.current_kb << "\n";
+        for (int e = 0; e < perf::N_EVENTS; ++e)
+            if (results.perf_valid[e])
+                std::cout << "  " << perf::names[e] << " per op: "
+                          << results.perf_per_op[e] << "\n";
+        if (results.contention)
+        {
+            auto values = instrumentation::values(*results.contention);
+            for (size_t f = 0; f < values.size(); ++f)
+                std::cout << "  " << instrumentation::names[f] << ": " << values[f] << "\n";
+            double rate = instrumentation::cas_failure_rate(*results.contention);
+            if (rate >= 0)
+                std::cout << "  CAS failure rate: " << rate << "\n";
+            double per_op = cas_per_op();
+            if (per_op >= 0)
+                std::cout << "  CASes per operation: " << per_op << "\n";
+            double hits = instrumentation::elimination_rate(*results.contention);
+            if (hits >= 0)
+                std::cout << "  Elimination hit rate: " << hits << "\n";
+        }
+        if (config.latency_sample > 0)
+            for (auto const &[op, h] : {std::pair{"push", &results.push_latency},
+                                        std::pair{"pop", &results.pop_latency}})
+                std::cout << "  " << op << " latency p50/p99 [ns]: <= " << h->quantile(0.5)
+                          << " / <= " << h->quantile(0.99) << " (" << h->count() << " samples)\n";
     };
 
+    int max_batch() const
+    {
+        int to_rtn = 0;
+        for (int b : config.batch_enque)
+            to_rtn = std::max(to_rtn, b);
+        for (int b : config.batch_deque)
+            to_rtn = std::max(to_rtn, b);
+        return to_rtn;
+    }
+
+    // Placement name, explicit cpu lists are appended as "list:0;2;4"
+    std::string placement_label() const
+    {
+        std::string label = affinity::to_string(config.placement);
+        if (config.placement != affinity::Placement::List)
+            return label;
+
+        label += ":";
+        for (size_t i = 0; i < config.cpu_list.size(); ++i)
+            label += (i ? ";" : "") + std::to_string(config.cpu_list[i]);
+        return label;
+    }
+
     void print_csv(std::string const &name, bool header = false) const
     {
         if (header)
         {
-            std::cout << "name,n_threads,avg_time,avg_timeout,operations,s_enq,s_deq,enq,deq\n";
+            std::cout << "name,n_threads,avg_time,avg_timeout,operations,s_enq,s_deq,enq,deq,"
+                         "repetitions,thr_mean,thr_median,thr_stddev,thr_ci95,placement,"
+                         "cycles_per_op,instructions_per_op,l1d_misses_per_op,llc_misses_per_op,branch_misses_per_op,"
+                         "recipe,max_batch,verify,backoff,size_tracking,fairness,"
+                         "nodes_allocated,free_nodes,max_free_per_thread,bytes_per_element,rss_peak_kb,rss_final_kb,"
+                         "payload_bytes,payload_mode,bytes_per_s";
+            for (auto const &field : instrumentation::names)
+                std::cout << "," << field;
+            std::cout << ",cas_failure_rate,elimination_rate,cas_per_op\n";
         }
 
         std::cout << name << ",";
@@ -579,8 +1110,298 @@ public:
         std::cout << results.total_succeded_enqueues << ",";
         std::cout << results.total_succeded_dequeues << ",";
         std::cout << results.total_enqueues << ",";
-        std::cout << results.total_dequeues;
+        std::cout << results.total_dequeues << ",";
+        std::cout << results.samples.size() << ",";
+        std::cout << results.throughput.mean << ",";
+        std::cout << results.throughput.median << ",";
+        std::cout << results.throughput.stddev << ",";
+        std::cout << results.throughput.ci95 << ",";
+        std::cout << placement_label();
+        for (int e = 0; e < perf::N_EVENTS; ++e)
+        {
+            std::cout << ",";
+            if (results.perf_valid[e])
+                std::cout << results.perf_per_op[e];
+            else
+                std::cout << "NA";
+        }
+        std::cout << "," << to_string(config.recipe);
+        std::cout << "," << max_batch();
+        std::cout << "," << (!config.verify ? "NA" : verification.ok() ? "ok" : "FAILED");
+        std::cout << "," << backoff::to_string(config.backoff);
+        std::cout << "," << sizing::to_string(config.size_tracking);
+        std::cout << "," << results.fairness;
+        if (results.allocation)
+        {
+            auto const &a = *results.allocation;
+            std::cout << "," << a.nodes_allocated << "," << a.free_total() << "," << a.free_max()
+                      << "," << a.bytes_per_element();
+        }
+        else
+            std::cout << ",NA,NA,NA,NA";
+        for (long kb : {results.rss.peak_kb, results.rss.current_kb})
+        {
+            std::cout << ",";
+            if (kb >= 0)
+                std::cout << kb;
+            else
+                std::cout << "NA";
+        }
+        std::cout << "," << config.payload_bytes << "," << payload::to_string(config.payload_mode);
+        std::cout << "," << results.throughput.mean * double(config.message_bytes());
+        for (size_t f = 0; f < instrumentation::names.size(); ++f)
+        {
+            std::cout << ",";
+            if (results.contention)
+                std::cout << instrumentation::values(*results.contention)[f];
+            else
+                std::cout << "NA";
+        }
+        for (auto rate : {instrumentation::cas_failure_rate, instrumentation::elimination_rate})
+        {
+            double value = results.contention ? rate(*results.contention) : -1.0;
+            std::cout << ",";
+            if (value >= 0)
+                std::cout << value;
+            else
+                std::cout << "NA";
+        }
+        if (double per_op = cas_per_op(); per_op >= 0)
+            std::cout << "," << per_op;
+        else
+            std::cout << ",NA";
         std::cout << std::endl;
     };
-    // void save_results(std::filesystem::path const &output) const {};
+
+    // "op":{"samples":n,"p50":...,"p99":...}, quantiles are bucket upper bounds
+    static void write_latency(std::ostream &out, char const *op, latency::Histogram const &h)
+    {
+        out << json::quote(op) << ":{\"samples\":" << h.count();
+        for (auto const &[label, q] : {std::pair{"p50", 0.5}, std::pair{"p90", 0.9},
+                                       std::pair{"p99", 0.99}, std::pair{"p999", 0.999}})
+        {
+            out << ",\"" << label << "\":";
+            hwbench::write_number(out, h.quantile(q));
+        }
+        out << "}";
+    }
+
+    // "telemetry":{...} of one repetition, ops are cumulative per thread
+    static void write_telemetry(std::ostream &out, telemetry::Series const &series)
+    {
+        out << ",\"telemetry\":{\"interval_ms\":" << series.interval_ms
+            << ",\"wrapped\":" << (series.wrapped() ? "true" : "false") << ",\"t\":[";
+        for (size_t i = 0; i < series.size(); ++i)
+            out << (i ? "," : "") << series.time(i);
+        out << "],\"depth\":[";
+        for (size_t i = 0; i < series.size(); ++i)
+            out << (i ? "," : "") << series.depth(i);
+        out << "],\"ops\":[";
+        for (size_t i = 0; i < series.size(); ++i)
+        {
+            out << (i ? "," : "") << "[";
+            for (size_t t = 0; t < series.n_threads(); ++t)
+                out << (t ? "," : "") << series.operations(i, t);
+            out << "]";
+        }
+        out << "]}";
+    }
+
+    // Appends the time series of every repetition to a CSV file, one line
+    // per sample and thread. The header is written if the file is new.
+    void save_telemetry(std::filesystem::path const &output,
+                        std::string const &name) const
+    {
+        bool is_new = !std::filesystem::exists(output) || std::filesystem::file_size(output) == 0;
+        std::ofstream out(output, std::ios::app);
+        if (!out)
+        {
+            std::cerr << "Could not open " << output << " for writing" << std::endl;
+            return;
+        }
+        if (is_new)
+            out << "name,n_threads,repetition,t,depth,thread,operations\n";
+
+        for (size_t r = 0; r < results.samples.size(); ++r)
+        {
+            telemetry::Series const &series = results.samples[r].telemetry;
+            for (size_t i = 0; i < series.size(); ++i)
+                for (size_t t = 0; t < series.n_threads(); ++t)
+                    out << name << "," << config.num_threads << "," << r << ","
+                        << series.time(i) << "," << series.depth(i) << ","
+                        << t << "," << series.operations(i, t) << "\n";
+        }
+    }
+
+    // Appends one self describing JSON record (one line) to output: the full
+    // config, host and build description, summary, per repetition samples
+    // and per thread counters.
+    void save_results(std::filesystem::path const &output,
+                      std::string const &name) const
+    {
+        std::ofstream out(output, std::ios::app);
+        if (!out)
+        {
+            std::cerr << "Could not open " << output << " for writing" << std::endl;
+            return;
+        }
+        out.precision(10);
+
+        host_info::HostInfo host = host_info::query();
+
+        out << "{\"name\":" << json::quote(name);
+        out << ",\"timestamp\":" << json::quote(host_info::timestamp());
+
+        out << ",\"host\":{\"hostname\":" << json::quote(host.hostname)
+            << ",\"cpu_model\":" << json::quote(host.cpu_model)
+            << ",\"logical_cpus\":" << host.logical_cpus << "}";
+
+        if (hardware)
+        {
+            out << ",\"hardware\":";
+            hwbench::write_json(out, *hardware);
+        }
+
+        out << ",\"build\":{\"compiler\":" << json::quote(host.compiler)
+            << ",\"cxxflags\":" << json::quote(host.cxxflags)
+            << ",\"commit\":" << json::quote(host.commit) << "}";
+
+        out << ",\"config\":{\"num_threads\":" << config.num_threads
+            << ",\"repetitions\":" << config.repetitions
+            << ",\"max_time_in_s\":" << config.max_time_in_s
+            << ",\"warmup_time_in_s\":" << config.warmup_time_in_s
+            << ",\"sets\":" << config.sets
+            << ",\"seed\":" << config.seed
+            << ",\"recipe\":" << json::quote(to_string(config.recipe))
+            << ",\"perf_counters\":" << (config.perf_counters ? "true" : "false")
+            << ",\"verify\":" << (config.verify ? "true" : "false")
+            << ",\"placement\":" << json::quote(affinity::to_string(config.placement))
+            << ",\"telemetry_interval_ms\":" << config.telemetry_interval_ms
+            << ",\"latency_sample\":" << config.latency_sample
+            << ",\"backoff\":" << json::quote(backoff::to_string(config.backoff))
+            << ",\"backoff_min_spins\":" << config.backoff_parameters.min_spins
+            << ",\"backoff_max_spins\":" << config.backoff_parameters.max_spins
+            << ",\"payload_bytes\":" << config.payload_bytes
+            << ",\"payload_mode\":" << json::quote(payload::to_string(config.payload_mode))
+            << ",\"size_tracking\":" << json::quote(sizing::to_string(config.size_tracking))
+            << ",\"cpu_list\":";
+        json::write_array(out, config.cpu_list);
+        out << ",\"batch_enque\":";
+        json::write_array(out, config.batch_enque);
+        out << ",\"batch_deque\":";
+        json::write_array(out, config.batch_deque);
+        out << "}";
+
+        out << ",\"summary\":{\"avg_time\":" << results.avg_time
+            << ",\"avg_timeout\":" << results.avg_timeout
+            << ",\"operations\":" << results.total_n_operations
+            << ",\"s_enq\":" << results.total_succeded_enqueues
+            << ",\"s_deq\":" << results.total_succeded_dequeues
+            << ",\"enq\":" << results.total_enqueues
+            << ",\"deq\":" << results.total_dequeues
+            << ",\"throughput\":{\"mean\":" << results.throughput.mean
+            << ",\"median\":" << results.throughput.median
+            << ",\"stddev\":" << results.throughput.stddev
+            << ",\"ci95\":" << results.throughput.ci95 << "}"
+            << ",\"fairness\":" << results.fairness
+            << ",\"bytes_per_s\":" << results.throughput.mean * double(config.message_bytes());
+        if (hardware && results.throughput.mean > 0)
+        {
+            // Time one thread spends per operation, in units of the primitives
+            double ns_per_op = double(config.num_threads) * 1e9 / results.throughput.mean;
+            out << ",\"relative\":{\"ns_per_op\":" << ns_per_op
+                << ",\"per_cas\":" << ns_per_op / hardware->cas_ns
+                << ",\"per_cas_contended\":" << ns_per_op / hardware->cas_contended_ns
+                << ",\"per_pingpong\":";
+            double pingpong = hardware->pingpong_mean();
+            hwbench::write_number(out, pingpong > 0 ? ns_per_op / pingpong : -1.0);
+            out << "}";
+        }
+        out << ",\"perf_per_op\":{";
+        bool first = true;
+        for (int e = 0; e < perf::N_EVENTS; ++e)
+        {
+            if (!results.perf_valid[e])
+                continue;
+            out << (first ? "" : ",") << json::quote(perf::names[e]) << ":"
+                << results.perf_per_op[e];
+            first = false;
+        }
+        out << "}";
+        if (config.verify)
+            out << ",\"verification\":{\"pushed\":" << verification.pushed
+                << ",\"popped\":" << verification.popped
+                << ",\"lost\":" << verification.lost
+                << ",\"duplicated\":" << verification.duplicated
+                << ",\"reordered\":" << verification.reordered
+                << ",\"unknown\":" << verification.unknown << "}";
+        if (results.contention)
+        {
+            auto values = instrumentation::values(*results.contention);
+            out << ",\"contention\":{";
+            for (size_t f = 0; f < values.size(); ++f)
+                out << (f ? "," : "") << json::quote(instrumentation::names[f]) << ":" << values[f];
+            out << ",\"cas_failure_rate\":";
+            hwbench::write_number(out, instrumentation::cas_failure_rate(*results.contention));
+            out << ",\"elimination_rate\":";
+            hwbench::write_number(out, instrumentation::elimination_rate(*results.contention));
+            out << ",\"cas_per_op\":";
+            hwbench::write_number(out, cas_per_op());
+            out << "}";
+        }
+        out << ",\"memory\":{\"rss_peak_kb\":" << results.rss.peak_kb
+            << ",\"rss_final_kb\":" << results.rss.current_kb;
+        if (results.allocation)
+        {
+            auto const &a = *results.allocation;
+            out << ",\"node_bytes\":" << a.node_bytes
+                << ",\"nodes_allocated\":" << a.nodes_allocated
+                << ",\"buffer_bytes\":" << a.buffer_bytes
+                << ",\"buffers_allocated\":" << a.buffers_allocated
+                << ",\"free_nodes\":";
+            json::write_array(out, a.free_nodes);
+        }
+        out << "}";
+        if (config.latency_sample > 0)
+        {
+            out << ",\"latency_ns\":{";
+            write_latency(out, "push", results.push_latency);
+            out << ",";
+            write_latency(out, "pop", results.pop_latency);
+            out << "}";
+        }
+        out << "}";
+
+        out << ",\"samples\":[";
+        for (size_t i = 0; i < results.samples.size(); ++i)
+        {
+            Sample const &s = results.samples[i];
+            out << (i ? "," : "") << "{\"time\":" << s.time
+                << ",\"timeout\":" << s.timeout
+                << ",\"operations\":" << s.n_operations
+                << ",\"s_enq\":" << s.succeded_enqueues
+                << ",\"s_deq\":" << s.succeded_dequeues
+                << ",\"enq\":" << s.enqueues
+                << ",\"deq\":" << s.dequeues
+                << ",\"throughput\":" << s.throughput
+                << ",\"fairness\":" << s.fairness
+                << ",\"threads\":[";
+            for (size_t t = 0; t < s.threads.size(); ++t)
+            {
+                Counter const &c = s.threads[t];
+                out << (t ? "," : "") << "{\"operations\":" << c.total_operations
+                    << ",\"s_enq\":" << c.succeeded_push
+                    << ",\"s_deq\":" << c.succeeded_pop
+                    << ",\"enq\":" << c.total_push
+                    << ",\"deq\":" << c.total_pop
+                    << ",\"time\":" << c.time
+                    << ",\"timeout\":" << c.timeout << "}";
+            }
+            out << "]";
+            if (s.telemetry.size() != 0)
+                write_telemetry(out, s.telemetry);
+            out << "}";
+        }
+        out << "]}" << std::endl;
+    };
 };
\ No newline at end of file
@@ -0,0 +1,129 @@
+/*
+Epoch based reclamation for nodes that other threads may still read after
+they were unlinked, e.g. the towers of skiplist.hpp. Tags (lock_free_aba)
+only make a CAS on a recycled node fail, they do not make it safe to read
+one, so a structure that walks many nodes per operation needs this.
+
+  enter(free) : before an operation. Hands the nodes whose grace period
+                is over to free(node), e.g. the thread's free list.
+  exit()      : after it
+  retire(n)   : n is unlinked, reuse it once no thread can reach it
+
+A thread announces the global epoch when it enters. Retired nodes go to the
+retiring thread's limbo list of the epoch at the time of the retirement.
+The global epoch only moves from e to e + 1 once every thread inside an
+operation has announced e, so when it reached e + 2 every thread that could
+have seen a node retired in e has left its operation. Three limbo lists per
+thread (epoch % 3) are enough. Threads try to move the epoch every
+advance_every retirements, a thread that stops retiring keeps its lists
+until it enters again.
+
+Limbo lists are chained through the nodes' next member, like the free
+lists. The domain is indexed with omp_get_thread_num(), so build it after
+setting the team size.
+*/
+
+#pragma once
+#include <omp.h>
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+namespace ebr
+{
+    inline constexpr unsigned advance_every = 64; // retirements of a thread between attempts
+
+    template <typename Node>
+    class Domain
+    {
+        static constexpr uint64_t outside = 0;
+
+        struct alignas(64) Participant
+        {
+            std::atomic<uint64_t> announced{outside}; // (epoch << 1) | 1 inside an operation
+            Node *limbo[3]{};
+            uint64_t limbo_epoch[3]{};
+            unsigned retired{0};
+        };
+
+        alignas(64) std::atomic<uint64_t> epoch{0};
+        std::vector<Participant> participants;
+
+        template <typename Free>
+        static void release(Participant &p, int i, Free &free)
+        {
+            Node *walker = p.limbo[i];
+            p.limbo[i] = nullptr;
+            while (walker != nullptr)
+            {
+                Node *current = walker;
+                walker = walker->next;
+                free(current);
+            }
+        }
+
+        bool try_advance(uint64_t e)
+        {
+            for (auto const &p : participants)
+            {
+                uint64_t a = p.announced.load(std::memory_order_seq_cst);
+                if (a != outside && (a >> 1) != e)
+                    return false;
+            }
+            return epoch.compare_exchange_strong(e, e + 1, std::memory_order_seq_cst);
+        }
+
+    public:
+        Domain() : participants(size_t(omp_get_max_threads())) {}
+
+        ~Domain()
+        {
+            auto drop = [](Node *n)
+            { delete n; };
+            for (auto &p : participants)
+                for (int i = 0; i < 3; ++i)
+                    release(p, i, drop);
+        }
+
+        Domain(Domain const &) = delete;
+        Domain(Domain &&) = delete;
+        Domain &operator=(Domain const &) = delete;
+        Domain &operator=(Domain &&) = delete;
+
+        template <typename Free>
+        void enter(Free &&free)
+        {
+            Participant &p = participants[omp_get_thread_num()];
+            uint64_t e = epoch.load(std::memory_order_seq_cst);
+            p.announced.store((e << 1) | 1, std::memory_order_seq_cst);
+            for (int i = 0; i < 3; ++i)
+                if (p.limbo[i] != nullptr && p.limbo_epoch[i] + 2 <= e)
+                    release(p, i, free);
+        }
+
+        void exit()
+        {
+            participants[omp_get_thread_num()].announced.store(outside, std::memory_order_release);
+        }
+
+        // Only between enter() and exit()
+        template <typename Free>
+        void retire(Node *n, Free &&free)
+        {
+            Participant &p = participants[omp_get_thread_num()];
+            uint64_t e = epoch.load(std::memory_order_seq_cst);
+            int i = int(e % 3);
+            if (p.limbo_epoch[i] != e)
+            {
+                // The list is from e - 3 or earlier
+                release(p, i, free);
+                p.limbo_epoch[i] = e;
+            }
+            n->next = p.limbo[i];
+            p.limbo[i] = n;
+            if (++p.retired % advance_every == 0)
+                try_advance(e);
+        }
+    };
+}; // namespace ebr
@@ -0,0 +1,207 @@
+/*
+Lock free queue with an elimination array in front (after Moir, Nussbaum,
+Shalev and Shavit, "Using elimination to implement scalable and lock-free
+FIFO queues").
+
+When the queue is empty, producers and consumers all fight over the one
+dummy node. Here a push that finds the queue empty first offers its value
+in a random slot of the exchange array and waits a short while. A pop that
+finds the queue empty looks at a random slot and takes the offer it finds
+there, and the value never touches the queue.
+
+FIFO order is kept because a pair only eliminates while the queue is
+empty. The pop reads the offer, then checks that the queue is empty
+(lock_free_aba::BasicQueue::empty()), then takes the offer with a CAS. If
+the CAS succeeds, the push was pending during the emptiness check, so both
+operations linearize at that check, the push right before the pop. An
+offer that is not taken within the patience is withdrawn (a CAS on the same
+slot), and the push goes to the queue.
+
+Slot words encode the offering thread and a per thread sequence number,
+the value and the message live in the offering thread's record. A stale
+read of the record is harmless because the CAS on the word fails then.
+*/
+
+#pragma once
+#include "backoff.hpp"
+#include "base_queue.hpp"
+#include "generics.hpp"
+#include "instrumentation.hpp"
+#include "lock_free_aba.hpp"
+#include "payload.hpp"
+#include "sizing.hpp"
+#include "spin.hpp"
+
+#include <omp.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+namespace elimination
+{
+    using value_t = generics::value_t;
+    inline constexpr value_t empty_val = generics::empty_val;
+
+    template <typename Instr = instrumentation::None, typename Backoff = backoff::None,
+              typename Payload = payload::None, typename Size = sizing::Shared>
+    class BasicQueue : public BaseQueue
+    {
+        static constexpr unsigned patience = 128; // pauses a push waits for a taker
+        static constexpr uint64_t free_slot = 0;
+
+        struct alignas(64) Slot
+        {
+            std::atomic<uint64_t> word{free_slot};
+        };
+
+        // Written only by its thread, read by the takers
+        struct alignas(64) Offer
+        {
+            std::atomic<value_t> value{empty_val};
+            typename Payload::Slot message;
+            uint32_t sequence{};
+            uint64_t rng{};
+        };
+
+        lock_free_aba::BasicQueue<Instr, Backoff, Payload, Size> queue;
+        std::vector<Slot> slots;
+        std::vector<Offer> offers;
+        Instr instr;
+        Payload messages; // of the eliminated pairs
+
+        static uint64_t word(size_t tid, uint32_t sequence)
+        {
+            return (uint64_t(tid + 1) << 32) | sequence;
+        }
+
+        static size_t owner(uint64_t word) { return size_t(word >> 32) - 1; }
+
+        // xorshift on the thread's record
+        size_t random_slot(Offer &mine)
+        {
+            mine.rng ^= mine.rng << 13;
+            mine.rng ^= mine.rng >> 7;
+            mine.rng ^= mine.rng << 17;
+            return size_t(mine.rng % slots.size());
+        }
+
+        // True if a pop took the value
+        bool offer(size_t tid, value_t val)
+        {
+            Offer &mine = offers[tid];
+            Slot &slot = slots[random_slot(mine)];
+            if (slot.word.load(std::memory_order_relaxed) != free_slot)
+                return false;
+
+            mine.value.store(val, std::memory_order_relaxed);
+            messages.write(mine.message, val);
+            uint64_t w = word(tid, ++mine.sequence);
+            uint64_t expected = free_slot;
+            if (!slot.word.compare_exchange_strong(expected, w, std::memory_order_release,
+                                                   std::memory_order_relaxed))
+            {
+                messages.consume(messages.take(mine.message)); // hands a pooled buffer back
+                return false;
+            }
+
+            for (unsigned i = 0; i < patience; ++i)
+            {
+                if (slot.word.load(std::memory_order_acquire) != w)
+                {
+                    instr.eliminated(true);
+                    return true;
+                }
+                spin::relax();
+            }
+
+            expected = w;
+            if (slot.word.compare_exchange_strong(expected, free_slot, std::memory_order_acq_rel))
+            {
+                instr.eliminated(false);
+                messages.consume(messages.take(mine.message));
+                return false;
+            }
+            instr.eliminated(true); // taken while withdrawing
+            return true;
+        }
+
+        // Value of an offer taken while the queue was empty, empty_val if none
+        value_t take(size_t tid)
+        {
+            Slot &slot = slots[random_slot(offers[tid])];
+            uint64_t w = slot.word.load(std::memory_order_acquire);
+            if (w == free_slot)
+                return empty_val;
+
+            Offer const &theirs = offers[owner(w)];
+            value_t val = theirs.value.load(std::memory_order_relaxed);
+            auto taken = messages.take(theirs.message);
+            if (!queue.empty())
+                return empty_val;
+            if (!slot.word.compare_exchange_strong(w, free_slot, std::memory_order_acq_rel))
+                return empty_val;
+            messages.consume(taken);
+            return val;
+        }
+
+    public:
+        explicit BasicQueue(Backoff backoff_policy = Backoff{})
+            : queue(backoff_policy),
+              slots(std::max<size_t>(1, size_t(omp_get_max_threads()) / 2)),
+              offers(size_t(omp_get_max_threads()))
+        {
+            for (size_t t = 0; t < offers.size(); ++t)
+                offers[t].rng = 0x9E3779B97F4A7C15ull * (t + 1);
+        }
+
+        BasicQueue(BasicQueue const &) = delete;
+        BasicQueue(BasicQueue &&) = delete;
+        BasicQueue &operator=(BasicQueue const &) = delete;
+        BasicQueue &operator=(BasicQueue &&) = delete;
+
+        bool push(value_t val) override
+        {
+            size_t tid = size_t(omp_get_thread_num());
+            if (queue.empty() && offer(tid, val))
+                return true;
+            return queue.push(val);
+        }
+
+        value_t pop() override
+        {
+            value_t val = queue.pop();
+            if (val != empty_val)
+                return val;
+            return take(size_t(omp_get_thread_num()));
+        }
+
+        // Offers in the array are pushes still in progress
+        int get_size() override { return queue.get_size(); }
+
+        std::optional<instrumentation::Contention> contention() const override
+        {
+            auto to_rtn = instr.contention();
+            if (to_rtn)
+                *to_rtn += *queue.contention();
+            return to_rtn;
+        }
+
+        void reset_contention() override
+        {
+            instr.reset();
+            queue.reset_contention();
+        }
+
+        std::optional<memory::Allocation> allocation() const override
+        {
+            auto to_rtn = queue.allocation();
+            if (to_rtn)
+                to_rtn->buffers_allocated += messages.buffers_allocated();
+            return to_rtn;
+        }
+    };
+
+    using Queue = BasicQueue<>;
+}; // namespace elimination
@@ -9,6 +9,10 @@ locks.
 #pragma once
 #include "base_queue.hpp"
 #include "generics.hpp"
+#include "backoff.hpp"
+#include "instrumentation.hpp"
+#include "payload.hpp"
+#include "sizing.hpp"
 #include <atomic>
 #include <cassert>
 #include <limits>
@@ -21,21 +25,27 @@ namespace fine_lock
     using value_t = generics::value_t; // To be changed if one will
     value_t empty_val = generics::empty_val;
 
-    struct Node
+    // Slot is the message of the payload policy (payload.hpp)
+    template <typename Slot>
+    struct BasicNode
     {
-        Node *next;
+        BasicNode *next;
         value_t value;
+        [[no_unique_address]] Slot payload;
     };
+    using Node = BasicNode<payload::None::Slot>;
 
-    class FreeList
+    template <typename Node>
+    class BasicFreeList
     {
         Node *header = nullptr;
         unsigned int size = 0;
+        size_t allocated = 0;
 
     public:
-        FreeList() = default;
+        BasicFreeList() = default;
 
-        ~FreeList()
+        ~BasicFreeList()
         {
             Node *walker = header;
             while (walker != nullptr)
@@ -54,7 +64,7 @@ namespace fine_lock
         // RULE OF 5 IMPLEMNTATION OF COPY CONSTRUCTORS AND SO ON
 
         // Copy constructor (deep copy)
-        FreeList(const FreeList &other)
+        BasicFreeList(const BasicFreeList &other)
         {
             if (!other.header)
             {
@@ -83,7 +93,7 @@ namespace fine_lock
         }
 
         // Copy assignment (deep copy)
-        FreeList &operator=(const FreeList &other)
+        BasicFreeList &operator=(const BasicFreeList &other)
         {
             if (this == &other)
                 return *this;
@@ -125,14 +135,14 @@ namespace fine_lock
         }
 
         // Move constructor
-        FreeList(FreeList &&other) noexcept
+        BasicFreeList(BasicFreeList &&other) noexcept
         {
             header = other.header;
             other.header = nullptr;
         }
 
         // Move assignment
-        FreeList &operator=(FreeList &&other) noexcept
+        BasicFreeList &operator=(BasicFreeList &&other) noexcept
         {
             if (this != &other)
             {
@@ -159,47 +169,50 @@ namespace fine_lock
             size++;
         }
 
-        Node *get(value_t val)
+        // Any free node will do, the caller overwrites the value
+        Node *get()
         {
             if (header == nullptr)
                 return nullptr;
 
-            if (header->value == val)
-            {
-                Node *to_rtn = header;
-                header = header->next;
-                size--;
-                return to_rtn;
-            }
-
-            auto walker = header;
-            while (walker->next != nullptr)
-            {
-                if (walker->next->value == val)
-                {
-                    auto to_rtn = walker->next;
-                    walker->next = walker->next->next;
-                    size--;
-                    return to_rtn;
-                }
-                walker = walker->next;
-            }
+            Node *to_rtn = header;
+            header = header->next;
+            size--;
+            return to_rtn;
+        }
 
-            return nullptr;
+        // Counts the nodes the owner had to allocate because the list was empty
+        Node *allocate()
+        {
+            ++allocated;
+            return new Node;
         }
+
+        size_t get_allocated() const { return allocated; }
+        unsigned int get_size() const { return size; }
     };
-class Queue : public BaseQueue
+    using FreeList = BasicFreeList<Node>;
+template <typename Instr = instrumentation::None, typename Backoff = backoff::None,
+          typename Payload = payload::None, typename Size = sizing::Shared>
+class BasicQueue : public BaseQueue
 { // FIFO
-    Node *header;
-    Node *tail;
+    using Node = BasicNode<typename Payload::Slot>;
+    using FreeList = BasicFreeList<Node>;
 
-    std::vector<FreeList> freelists;
-    std::atomic<int> size;
+    // Consumers and producers each keep to their own cache line
+    alignas(64) Node *header;
     omp_lock_t header_lock;
+    alignas(64) Node *tail;
     omp_lock_t tail_lock;
 
+    alignas(64) std::vector<FreeList> freelists;
+    Instr instr;
+    Payload messages;
+    Backoff manager;
+    Size tracker; // aligns its own counters (sizing.hpp)
+
 public:
-    Queue()
+    explicit BasicQueue(Backoff backoff_policy = Backoff{}) : manager(backoff_policy)
     {
         omp_init_lock(&header_lock);
         omp_init_lock(&tail_lock);
@@ -207,12 +220,11 @@ public:
         header->next = nullptr;
         header->value = empty_val;
         tail = header;
-        size = 0;
         int n_threads = omp_get_max_threads();
         freelists.resize(n_threads);
     };
 
-    ~Queue()
+    ~BasicQueue()
     {
         Node *walker = header;
         while (walker != nullptr)
@@ -229,18 +241,18 @@ public:
     bool push(value_t val) override
     {
         int tid = omp_get_thread_num();
-        Node *n = freelists[tid].get(val);
+        Node *n = freelists[tid].get();
+        instr.freelist(n != nullptr);
         if (n == nullptr)
-        {
-            n = new Node;
-            n->value = val;
-        }
+            n = freelists[tid].allocate();
+        n->value = val;
+        messages.write(n->payload, val);
         n->next = nullptr;
 
-        omp_set_lock(&tail_lock);
+        instr.acquire(tail_lock, manager);
         tail->next = n;
         tail = n;
-        size++;
+        tracker.pushed();
         omp_unset_lock(&tail_lock);
 
         return true;
@@ -250,7 +262,7 @@ public:
     {
         int tid = omp_get_thread_num();
 
-        omp_set_lock(&header_lock);
+        instr.acquire(header_lock, manager);
 
         Node *current = header->next;
         if (current == nullptr)
@@ -264,7 +276,7 @@ public:
         // If current->next is nullptr, we might be removing the tail
         if (current->next == nullptr)
         {
-            omp_set_lock(&tail_lock);
+            instr.acquire(tail_lock, manager);
             
             // Remove current from the queue
             header->next = current->next;  // Will be nullptr
@@ -275,30 +287,49 @@ public:
                 tail = header;
             }
             
-            size--;
+            tracker.popped();
             omp_unset_lock(&tail_lock);
             omp_unset_lock(&header_lock);
         }
         else
         {
             header->next = current->next;
-            size--;
+            tracker.popped();
             omp_unset_lock(&header_lock);
         }
 
+        // current is unlinked, no other thread sees it any more
+        messages.consume(messages.take(current->payload));
         freelists[tid].push(current);
         return val;
     }
 
-    int get_size() override { return size.load(); }
+    int get_size() override { return tracker.get(); }
+
+    std::optional<instrumentation::Contention> contention() const override { return instr.contention(); }
+    void reset_contention() override { instr.reset(); }
+
+    std::optional<memory::Allocation> allocation() const override
+    {
+        memory::Allocation to_rtn{sizeof(Node), 1, {}, // the dummy node
+                                  messages.buffer_bytes(), messages.buffers_allocated()};
+        for (auto const &f : freelists)
+        {
+            to_rtn.nodes_allocated += f.get_allocated();
+            to_rtn.free_nodes.push_back(f.get_size());
+        }
+        return to_rtn;
+    }
 
     Node const *get_head() const { return header; }
     Node const *get_tail() const { return tail; }
 
-    Queue(Queue const &other) = delete;
-    Queue(Queue &&other) = delete;  // ✅ Fixed syntax
+    BasicQueue(BasicQueue const &other) = delete;
+    BasicQueue(BasicQueue &&other) = delete;  // ✅ Fixed syntax
 
-    Queue &operator=(Queue const &other) = delete;
-    Queue &operator=(Queue &&other) = delete;  // ✅ Fixed syntax
+    BasicQueue &operator=(BasicQueue const &other) = delete;
+    BasicQueue &operator=(BasicQueue &&other) = delete;  // ✅ Fixed syntax
 };
+
+using Queue = BasicQueue<>;
 }; // namespace finelock
\ No newline at end of file
@@ -1,10 +1,30 @@
 #pragma once
+#include <cstdint>
 #include <limits>
 
 namespace generics
 {
-using value_t = int;
+using value_t = std::int64_t;
 constexpr value_t empty_val = -1000000; // if your queue only stores 0..1999
 // using value_t = int;
 
-}; // namespace generics
\ No newline at end of file
+// Unique values for the verification modes: the producer id in the low
+// bits, the producer's sequence number above it. Always >= 0.
+constexpr int producer_bits = 16;
+
+constexpr value_t encode(std::uint64_t producer, std::uint64_t sequence)
+{
+    return static_cast<value_t>((sequence << producer_bits) | producer);
+}
+
+constexpr std::uint64_t producer_of(value_t v)
+{
+    return static_cast<std::uint64_t>(v) & ((std::uint64_t(1) << producer_bits) - 1);
+}
+
+constexpr std::uint64_t sequence_of(value_t v)
+{
+    return static_cast<std::uint64_t>(v) >> producer_bits;
+}
+
+}; // namespace generics
@@ -0,0 +1,93 @@
+/*
+Sequential binary min heap with the interface of the queues: push inserts a
+value, pop removes the smallest one (the value is the priority). It is the
+baseline of the concurrent priority queue of skiplist.hpp, wrapped in one
+lock by global_lock::BasicHeap.
+
+The elements live in one std::vector, so there are no nodes and no free
+list: the popped slots stay allocated and are reused by the next pushes.
+allocation() reports the vector's capacity as the allocated nodes and the
+unused part of it as the free list.
+*/
+
+#pragma once
+#include "backoff.hpp"
+#include "base_queue.hpp"
+#include "generics.hpp"
+#include "instrumentation.hpp"
+#include "payload.hpp"
+
+#include <algorithm>
+#include <vector>
+
+namespace heap
+{
+    using value_t = generics::value_t;
+    inline constexpr value_t empty_val = generics::empty_val;
+
+    template <typename Slot>
+    struct BasicElement
+    {
+        value_t value;
+        [[no_unique_address]] Slot payload;
+    };
+
+    // Backoff is accepted for a uniform registry, a single thread never waits
+    template <typename Instr = instrumentation::None, typename Backoff = backoff::None,
+              typename Payload = payload::None>
+    class BasicQueue : public BaseQueue
+    {
+        using Element = BasicElement<typename Payload::Slot>;
+
+        std::vector<Element> elements;
+        Instr instr;
+        Payload messages;
+
+        // std::push_heap builds a max heap, so the larger value is the lower priority
+        static bool later(Element const &a, Element const &b) { return a.value > b.value; }
+
+    public:
+        explicit BasicQueue(Backoff = Backoff{}) {}
+
+        BasicQueue(BasicQueue const &) = delete;
+        BasicQueue(BasicQueue &&) = delete;
+        BasicQueue &operator=(BasicQueue const &) = delete;
+        BasicQueue &operator=(BasicQueue &&) = delete;
+
+        bool push(value_t val) override
+        {
+            instr.freelist(elements.size() < elements.capacity());
+            elements.emplace_back();
+            elements.back().value = val;
+            messages.write(elements.back().payload, val);
+            std::push_heap(elements.begin(), elements.end(), later);
+            return true;
+        }
+
+        value_t pop() override
+        {
+            if (elements.empty())
+                return empty_val;
+
+            std::pop_heap(elements.begin(), elements.end(), later);
+            value_t val = elements.back().value;
+            messages.consume(messages.take(elements.back().payload));
+            elements.pop_back();
+            return val;
+        }
+
+        int get_size() override { return int(elements.size()); }
+
+        std::optional<instrumentation::Contention> contention() const override { return instr.contention(); }
+        void reset_contention() override { instr.reset(); }
+
+        std::optional<memory::Allocation> allocation() const override
+        {
+            return memory::Allocation{sizeof(Element), elements.capacity(),
+                                      {elements.capacity() - elements.size()},
+                                      messages.buffer_bytes(), messages.buffers_allocated()};
+        }
+    };
+
+    using Queue = BasicQueue<>;
+}; // namespace heap
@@ -0,0 +1,221 @@
+/*
+History recording and an offline linearizability check for FIFO queues.
+
+Every thread writes the invoke and response timestamps of its operations
+into its own preallocated buffer, so recording takes no lock and no
+allocation. After the run the histories are merged and checked.
+
+Since every pushed value is unique (generics::encode), linearizability of
+a queue history reduces to the absence of four violation patterns
+(Henzinger, Sezgin, Vafeiadis, "Aspect-Oriented Linearizability Proofs",
+CONCUR 2013):
+
+  fresh     : a pop returns a value that was never pushed
+  duplicate : a value is popped more than once
+  order     : push(a) returns before push(b) is invoked, but pop(b)
+              returns before pop(a) is invoked
+  empty     : a pop returns empty while the queue is non-empty during its
+              whole interval, i.e. the interval is covered by the union of
+              the intervals (push(x) returned, pop(x) invoked)
+
+The queue is drained after the run and the drain is part of the history,
+so a pushed value that is never popped is reported as lost.
+All checks are O(n log n) in the number of operations.
+*/
+
+#pragma once
+#include "generics.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <unordered_map>
+#include <vector>
+
+namespace history
+{
+    using value_t = generics::value_t;
+
+    enum class Op : uint8_t
+    {
+        Push,
+        Pop
+    };
+
+    struct Event
+    {
+        int64_t invoke;   // ns, steady clock
+        int64_t response; // ns, steady clock
+        value_t value;    // generics::empty_val for an empty pop
+        Op op;
+    };
+
+    inline int64_t now()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch())
+            .count();
+    }
+
+    class alignas(64) ThreadHistory
+    {
+        std::vector<Event> events;
+        size_t count = 0;
+
+    public:
+        explicit ThreadHistory(size_t capacity = 0) : events(capacity) {}
+
+        bool full() const { return count == events.size(); }
+
+        void record(Op op, value_t value, int64_t invoke, int64_t response)
+        {
+            events[count++] = Event{invoke, response, value, op};
+        }
+
+        size_t size() const { return count; }
+        Event const *begin() const { return events.data(); }
+        Event const *end() const { return events.data() + count; }
+        void clear() { count = 0; }
+    };
+
+    struct Report
+    {
+        size_t operations{};
+        size_t fresh{};
+        size_t duplicates{};
+        size_t lost{};
+        size_t order_violations{};
+        size_t empty_violations{};
+
+        bool ok() const
+        {
+            return fresh + duplicates + lost + order_violations + empty_violations == 0;
+        }
+
+        Report &operator+=(Report const &other)
+        {
+            operations += other.operations;
+            fresh += other.fresh;
+            duplicates += other.duplicates;
+            lost += other.lost;
+            order_violations += other.order_violations;
+            empty_violations += other.empty_violations;
+            return *this;
+        }
+    };
+
+    inline Report check(std::vector<ThreadHistory> const &histories)
+    {
+        constexpr int64_t never = std::numeric_limits<int64_t>::max();
+
+        struct Life
+        {
+            int64_t push_invoke = never;
+            int64_t push_response = never;
+            int64_t pop_invoke = never;
+            int64_t pop_response = never;
+            uint32_t pushes = 0;
+            uint32_t pops = 0;
+        };
+
+        Report report{};
+        std::unordered_map<value_t, Life> lives;
+        std::vector<Event> empties;
+
+        for (auto const &h : histories)
+        {
+            report.operations += h.size();
+            for (Event const &e : h)
+            {
+                if (e.op == Op::Pop && e.value == generics::empty_val)
+                {
+                    empties.push_back(e);
+                    continue;
+                }
+
+                Life &life = lives[e.value];
+                if (e.op == Op::Push)
+                {
+                    life.push_invoke = e.invoke;
+                    life.push_response = e.response;
+                    life.pushes++;
+                }
+                else
+                {
+                    life.pop_invoke = std::min(life.pop_invoke, e.invoke);
+                    life.pop_response = std::min(life.pop_response, e.response);
+                    life.pops++;
+                }
+            }
+        }
+
+        std::vector<Life const *> complete; // pushed once and popped once
+        for (auto const &[value, life] : lives)
+        {
+            if (life.pushes == 0)
+                report.fresh++;
+            else if (life.pops == 0)
+                report.lost++;
+            else if (life.pops > 1)
+                report.duplicates += life.pops - 1;
+            else
+                complete.push_back(&life);
+        }
+
+        // order: sweep over b by push invoke, a enters once push(a) returned
+        std::vector<Life const *> by_push_response = complete;
+        std::sort(by_push_response.begin(), by_push_response.end(),
+                  [](Life const *a, Life const *b)
+                  { return a->push_response < b->push_response; });
+        std::vector<Life const *> by_push_invoke = complete;
+        std::sort(by_push_invoke.begin(), by_push_invoke.end(),
+                  [](Life const *a, Life const *b)
+                  { return a->push_invoke < b->push_invoke; });
+
+        int64_t latest_pop_invoke = std::numeric_limits<int64_t>::min();
+        size_t next_a = 0;
+        for (Life const *b : by_push_invoke)
+        {
+            while (next_a < by_push_response.size() &&
+                   by_push_response[next_a]->push_response < b->push_invoke)
+            {
+                latest_pop_invoke = std::max(latest_pop_invoke,
+                                             by_push_response[next_a]->pop_invoke);
+                ++next_a;
+            }
+            if (latest_pop_invoke > b->pop_response)
+                report.order_violations++;
+        }
+
+        // empty: merge the intervals in which a value is surely in the queue
+        std::vector<std::pair<int64_t, int64_t>> present;
+        for (Life const *life : complete)
+            if (life->push_response < life->pop_invoke)
+                present.emplace_back(life->push_response, life->pop_invoke);
+        std::sort(present.begin(), present.end());
+
+        std::vector<std::pair<int64_t, int64_t>> merged;
+        for (auto const &interval : present)
+        {
+            if (!merged.empty() && interval.first < merged.back().second)
+                merged.back().second = std::max(merged.back().second, interval.second);
+            else
+                merged.push_back(interval);
+        }
+
+        for (Event const &e : empties)
+        {
+            // last merged interval starting before the pop was invoked
+            auto it = std::upper_bound(merged.begin(), merged.end(),
+                                       std::make_pair(e.invoke, std::numeric_limits<int64_t>::max()));
+            if (it == merged.begin())
+                continue;
+            --it;
+            if (it->first < e.invoke && e.response < it->second)
+                report.empty_violations++;
+        }
+
+        return report;
+    }
+}; // namespace history
@@ -0,0 +1,94 @@
+/*
+Description of the machine and the build a result was produced with.
+
+The compiler flags and the git commit are baked in by the Makefile
+(AMP_CXXFLAGS, AMP_GIT_COMMIT); everything else is queried at run time.
+*/
+
+#pragma once
+#include <unistd.h>
+
+#include <chrono>
+#include <ctime>
+#include <fstream>
+#include <string>
+#include <thread>
+
+#ifndef AMP_CXXFLAGS
+#define AMP_CXXFLAGS "unknown"
+#endif
+
+#ifndef AMP_GIT_COMMIT
+#define AMP_GIT_COMMIT "unknown"
+#endif
+
+namespace host_info
+{
+    struct HostInfo
+    {
+        std::string hostname;
+        std::string cpu_model;
+        unsigned int logical_cpus{};
+        std::string compiler;
+        std::string cxxflags;
+        std::string commit;
+    };
+
+    inline std::string cpu_model()
+    {
+        std::ifstream in("/proc/cpuinfo");
+        std::string line;
+        while (std::getline(in, line))
+        {
+            if (line.rfind("model name", 0) != 0)
+                continue;
+            auto colon = line.find(':');
+            if (colon != std::string::npos && colon + 2 <= line.size())
+                return line.substr(colon + 2);
+        }
+        return "unknown";
+    }
+
+    inline std::string hostname()
+    {
+        char buf[256] = {};
+        if (gethostname(buf, sizeof(buf) - 1) != 0)
+            return "unknown";
+        return buf;
+    }
+
+    inline std::string compiler()
+    {
+#if defined(__clang__)
+        return std::string("clang ") + __clang_version__;
+#elif defined(__GNUC__)
+        return std::string("gcc ") + __VERSION__;
+#else
+        return "unknown";
+#endif
+    }
+
+    inline HostInfo query()
+    {
+        HostInfo to_rtn;
+        to_rtn.hostname = hostname();
+        to_rtn.cpu_model = cpu_model();
+        to_rtn.logical_cpus = std::thread::hardware_concurrency();
+        to_rtn.compiler = compiler();
+        to_rtn.cxxflags = AMP_CXXFLAGS;
+        to_rtn.commit = AMP_GIT_COMMIT;
+        return to_rtn;
+    }
+
+    // UTC, ISO 8601
+    inline std::string timestamp()
+    {
+        std::time_t now = std::chrono::system_clock::to_time_t(
+            std::chrono::system_clock::now());
+        std::tm utc{};
+        gmtime_r(&now, &utc);
+        char buf[32];
+        std::strftime(buf, sizeof(buf), "%Y-%m-%dT%H:%M:%SZ", &utc);
+        return buf;
+    }
+}; // namespace host_info
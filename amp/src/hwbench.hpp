@@ -0,0 +1,326 @@
+/*
+Hardware characterization, so queue results from different machines can be
+put relative to the primitives they are built from:
+
+  pingpong  : one way latency of a cache line bounced between two pinned
+              threads, for every pair of the given cpus (a matrix)
+  cas / faa : cost of one compare_exchange / fetch_add on a private line,
+              and per thread when several threads hammer the same line
+  lock      : omp_lock_t handed back and forth between two threads
+
+Every measurement runs against a time budget and spins with a pause and an
+occasional yield, so the suite also terminates on an oversubscribed box.
+Values that could not be measured are -1 (no NaN, the build uses
+-ffast-math).
+*/
+
+#pragma once
+#include "affinity.hpp"
+#include "json.hpp"
+#include "spin.hpp"
+
+#include <omp.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <ostream>
+#include <thread>
+#include <vector>
+
+namespace hwbench
+{
+    using clock = std::chrono::steady_clock;
+
+    struct Characterization
+    {
+        std::vector<int> cpus;                        // of the ping-pong matrix
+        std::vector<std::vector<double>> pingpong_ns; // one way, -1 on the diagonal
+        double cas_ns{};                              // uncontended
+        double faa_ns{};
+        int contended_threads{};
+        double cas_contended_ns{}; // per operation of one thread
+        double faa_contended_ns{};
+        double lock_handoff_ns{};
+
+        // Mean over all pairs, -1 with less than two cpus
+        double pingpong_mean() const
+        {
+            double sum = 0;
+            size_t n = 0;
+            for (size_t i = 0; i < pingpong_ns.size(); ++i)
+                for (size_t j = 0; j < pingpong_ns[i].size(); ++j)
+                    if (i != j)
+                    {
+                        sum += pingpong_ns[i][j];
+                        ++n;
+                    }
+            return n ? sum / double(n) : -1.0;
+        }
+    };
+
+    inline void pin(int cpu)
+    {
+        if (cpu >= 0)
+            affinity::pin_current_thread(cpu);
+    }
+
+    inline double seconds_since(clock::time_point start)
+    {
+        return std::chrono::duration<double>(clock::now() - start).count();
+    }
+
+    // One way latency in ns between cpu a and cpu b
+    inline double pingpong(int a, int b, double budget_s, uint64_t max_rounds = 100000)
+    {
+        constexpr uint64_t stop = std::numeric_limits<uint64_t>::max();
+        alignas(64) std::atomic<uint64_t> flag{0};
+        alignas(64) std::atomic<bool> ready{false};
+        double to_rtn = 0;
+
+        std::thread pong([&]
+                         {
+            pin(b);
+            ready.store(true, std::memory_order_release);
+            uint64_t last = 0;
+            while (true)
+            {
+                uint64_t v;
+                spin::until([&] { return (v = flag.load(std::memory_order_acquire)) != last; });
+                if (v == stop)
+                    return;
+                last = v + 1;
+                flag.store(last, std::memory_order_release);
+            } });
+
+        std::thread ping([&]
+                         {
+            pin(a);
+            spin::until([&] { return ready.load(std::memory_order_acquire); });
+            uint64_t rounds = 0;
+            auto start = clock::now();
+            while (rounds < max_rounds)
+            {
+                uint64_t v = 2 * rounds + 1;
+                flag.store(v, std::memory_order_release);
+                spin::until([&] { return flag.load(std::memory_order_acquire) == v + 1; });
+                ++rounds;
+                if (rounds % 64 == 0 && seconds_since(start) > budget_s)
+                    break;
+            }
+            to_rtn = seconds_since(start) * 1e9 / double(2 * rounds);
+            flag.store(stop, std::memory_order_release); });
+
+        ping.join();
+        pong.join();
+        return to_rtn;
+    }
+
+    // ns per operation of a single thread on a private cache line
+    inline void uncontended(double &cas_ns, double &faa_ns, uint64_t n = 1 << 22)
+    {
+        alignas(64) std::atomic<uint64_t> word{0};
+
+        auto start = clock::now();
+        for (uint64_t i = 0; i < n; ++i)
+        {
+            uint64_t expected = i;
+            word.compare_exchange_strong(expected, i + 1, std::memory_order_acq_rel);
+        }
+        cas_ns = seconds_since(start) * 1e9 / double(n);
+
+        start = clock::now();
+        for (uint64_t i = 0; i < n; ++i)
+            word.fetch_add(1, std::memory_order_acq_rel);
+        faa_ns = seconds_since(start) * 1e9 / double(n);
+    }
+
+    // ns per successful operation and thread, all threads on one line
+    template <typename Op>
+    double contended(std::vector<int> const &cpus, int n_threads, double budget_s, Op op)
+    {
+        alignas(64) std::atomic<uint64_t> word{0};
+        alignas(64) std::atomic<int> arrived{0};
+        std::vector<double> ns(n_threads);
+
+        std::vector<std::thread> threads;
+        for (int t = 0; t < n_threads; ++t)
+            threads.emplace_back([&, t]
+                                 {
+                pin(cpus.empty() ? -1 : cpus[t % cpus.size()]);
+                arrived.fetch_add(1);
+                spin::until([&] { return arrived.load() == n_threads; });
+
+                uint64_t ops = 0;
+                auto start = clock::now();
+                do
+                {
+                    for (int i = 0; i < 256; ++i)
+                        op(word);
+                    ops += 256;
+                } while (seconds_since(start) < budget_s);
+                ns[t] = seconds_since(start) * 1e9 / double(ops); });
+
+        for (auto &t : threads)
+            t.join();
+        double sum = 0;
+        for (double v : ns)
+            sum += v;
+        return sum / n_threads;
+    }
+
+    // ns per handoff of an omp lock that two threads take in strict turns
+    inline double lock_handoff(int a, int b, double budget_s)
+    {
+        omp_lock_t lock;
+        omp_init_lock(&lock);
+        int turn = 0; // protected by lock
+        alignas(64) std::atomic<bool> done{false};
+        alignas(64) std::atomic<int> arrived{0};
+        uint64_t handoffs = 0; // turns of thread 0, each one is two handoffs
+        double elapsed = 0;
+
+        auto player = [&](int me, int cpu)
+        {
+            pin(cpu);
+            arrived.fetch_add(1);
+            spin::until([&]
+                       { return arrived.load() == 2; });
+            auto start = clock::now();
+            for (uint64_t i = 1; !done.load(std::memory_order_relaxed); ++i)
+            {
+                omp_set_lock(&lock);
+                if (turn == me)
+                {
+                    turn = 1 - me;
+                    if (me == 0)
+                        handoffs++;
+                }
+                omp_unset_lock(&lock);
+
+                if (me == 0 && i % 64 == 0 && seconds_since(start) > budget_s)
+                {
+                    elapsed = seconds_since(start);
+                    done.store(true, std::memory_order_relaxed);
+                }
+            }
+        };
+
+        std::thread first(player, 0, a);
+        std::thread second(player, 1, b);
+        first.join();
+        second.join();
+        omp_destroy_lock(&lock);
+        if (handoffs == 0)
+            return -1.0;
+        return elapsed * 1e9 / double(2 * handoffs);
+    }
+
+    // cpus empty: every online cpu. budget_s is per measurement, the matrix
+    // gets a tenth of it per pair.
+    inline Characterization run(std::vector<int> cpus, double budget_s = 0.1)
+    {
+        if (cpus.empty())
+            for (auto const &info : affinity::read_topology())
+                cpus.push_back(info.cpu);
+        std::sort(cpus.begin(), cpus.end());
+
+        Characterization to_rtn{};
+        to_rtn.cpus = cpus;
+        size_t n = cpus.size();
+        to_rtn.pingpong_ns.assign(n, std::vector<double>(n, -1.0));
+        for (size_t i = 0; i < n; ++i)
+            for (size_t j = i + 1; j < n; ++j)
+                to_rtn.pingpong_ns[i][j] = to_rtn.pingpong_ns[j][i] =
+                    pingpong(cpus[i], cpus[j], budget_s / 10);
+
+        uncontended(to_rtn.cas_ns, to_rtn.faa_ns);
+
+        to_rtn.contended_threads = int(std::clamp<size_t>(n, 2, 8));
+        to_rtn.cas_contended_ns = contended(cpus, to_rtn.contended_threads, budget_s,
+                                            [](std::atomic<uint64_t> &w)
+                                            {
+                                                uint64_t v = w.load(std::memory_order_relaxed);
+                                                while (!w.compare_exchange_weak(v, v + 1, std::memory_order_acq_rel))
+                                                    ;
+                                            });
+        to_rtn.faa_contended_ns = contended(cpus, to_rtn.contended_threads, budget_s,
+                                            [](std::atomic<uint64_t> &w)
+                                            { w.fetch_add(1, std::memory_order_acq_rel); });
+
+        int a = n > 0 ? cpus[0] : -1;
+        int b = n > 1 ? cpus[1] : -1;
+        to_rtn.lock_handoff_ns = lock_handoff(a, b, budget_s);
+        return to_rtn;
+    }
+
+    // null for values that were not measured
+    inline void write_number(std::ostream &out, double v)
+    {
+        if (v < 0)
+            out << "null";
+        else
+            out << v;
+    }
+
+    inline void write_json(std::ostream &out, Characterization const &hw)
+    {
+        out << "{\"cpus\":";
+        json::write_array(out, hw.cpus);
+        out << ",\"pingpong_ns\":[";
+        for (size_t i = 0; i < hw.pingpong_ns.size(); ++i)
+        {
+            out << (i ? "," : "") << "[";
+            for (size_t j = 0; j < hw.pingpong_ns[i].size(); ++j)
+            {
+                out << (j ? "," : "");
+                write_number(out, hw.pingpong_ns[i][j]);
+            }
+            out << "]";
+        }
+        out << "],\"pingpong_mean_ns\":";
+        write_number(out, hw.pingpong_mean());
+        out << ",\"cas_ns\":" << hw.cas_ns
+            << ",\"faa_ns\":" << hw.faa_ns
+            << ",\"contended_threads\":" << hw.contended_threads
+            << ",\"cas_contended_ns\":" << hw.cas_contended_ns
+            << ",\"faa_contended_ns\":" << hw.faa_contended_ns
+            << ",\"lock_handoff_ns\":";
+        write_number(out, hw.lock_handoff_ns);
+        out << "}";
+    }
+
+    inline void print(std::ostream &out, Characterization const &hw)
+    {
+        out << "Hardware characterization\n"
+            << "  cas (uncontended):             " << hw.cas_ns << " ns\n"
+            << "  faa (uncontended):             " << hw.faa_ns << " ns\n"
+            << "  cas (" << hw.contended_threads << " threads, one line):    " << hw.cas_contended_ns << " ns\n"
+            << "  faa (" << hw.contended_threads << " threads, one line):    " << hw.faa_contended_ns << " ns\n"
+            << "  omp lock handoff:              " << hw.lock_handoff_ns << " ns\n"
+            << "  ping-pong one way, mean:       " << hw.pingpong_mean() << " ns\n";
+        if (hw.cpus.size() < 2)
+            return;
+
+        out << "  ping-pong matrix [ns]\n       ";
+        for (int cpu : hw.cpus)
+            out << "\t" << cpu;
+        out << "\n";
+        for (size_t i = 0; i < hw.cpus.size(); ++i)
+        {
+            out << "  " << hw.cpus[i];
+            for (size_t j = 0; j < hw.cpus.size(); ++j)
+            {
+                out << "\t";
+                if (i == j)
+                    out << "-";
+                else
+                    out << std::lround(hw.pingpong_ns[i][j]);
+            }
+            out << "\n";
+        }
+    }
+}; // namespace hwbench
@@ -0,0 +1,349 @@
+/*
+Adaptive queue that switches between a lock based and a lock free
+representation depending on contention.
+
+A sequential queue behind one omp lock (like global_lock) is the cheapest
+queue at one or two threads, the lock free queue wins once many threads
+fight over the lock. This queue holds one of each, all elements live in
+the current one, and moves between them while it runs.
+
+Signals: every thread counts its operations and its conflicts, i.e. lock
+acquisitions that had to wait and failed CASes of the lock free queue. Both
+are seen through Watch, a wrapper of the backoff policy: the lock is taken
+through it and the lock free queue calls its failed() after every failed
+CAS, so the signals do not depend on the instrumentation policy.
+
+Decisions: every check_every operations a thread tries to become the
+decider. At most every interval_s it computes the throughput and the
+conflicts per operation of the last window and switches
+  locked    -> lock free when conflicts per operation exceed lock_to_free
+  lock free -> locked    when they drop below free_to_lock
+The window after a switch is a probe: if the new representation does worse
+than worse times the last throughput of the old one, the switch is undone
+and no switch is tried for the next hold decisions, hold doubling up to
+max_hold. So the queue follows whichever representation is faster.
+
+Transition: operations announce themselves in their thread's slot and
+check the mode again (a Dekker style handshake, both sides seq_cst). The
+decider sets the mode to Switching, waits until no slot is active, moves
+the elements over in FIFO order and publishes the new mode. New operations
+wait while the mode is Switching. Every operation thus runs entirely in one
+representation. The pause of a switch grows with the number of queued
+elements, which the hold after an undone switch keeps rare.
+*/
+
+#pragma once
+#include "backoff.hpp"
+#include "base_queue.hpp"
+#include "generics.hpp"
+#include "instrumentation.hpp"
+#include "lock_free_aba.hpp"
+#include "payload.hpp"
+#include "sequential.hpp"
+#include "sizing.hpp"
+#include "spin.hpp"
+
+#include <omp.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <tuple>
+#include <vector>
+
+namespace hybrid
+{
+    using value_t = generics::value_t;
+    inline constexpr value_t empty_val = generics::empty_val;
+
+    inline constexpr unsigned check_every = 1024; // operations of a thread between decision attempts
+    inline constexpr double interval_s = 0.002;   // at least between two decisions
+    inline constexpr double lock_to_free = 0.02;  // waiting acquisitions per operation
+    inline constexpr double free_to_lock = 0.002; // failed CASes per operation
+    inline constexpr double worse = 0.9;          // share of the old throughput a switch must keep
+    inline constexpr unsigned max_hold = 64;      // decisions without a switch after an undone one
+
+    enum class Mode
+    {
+        Locked,
+        LockFree,
+        Switching
+    };
+
+    // Written by its thread only, read by the decider
+    struct alignas(64) Slot
+    {
+        std::atomic<bool> active{false};
+        std::atomic<uint64_t> ops{0};
+        std::atomic<uint64_t> conflicts{0};
+    };
+
+    inline void bump(std::atomic<uint64_t> &counter)
+    {
+        counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    // Backoff policy that counts the waits and failures of its thread
+    template <typename Backoff>
+    struct Watch
+    {
+        Backoff manager;
+        Slot *slots;
+
+        void conflict() const { bump(slots[omp_get_thread_num()].conflicts); }
+
+        void failed(unsigned &attempts) const
+        {
+            conflict();
+            manager.failed(attempts);
+        }
+
+        void lock(omp_lock_t &l) const
+        {
+            if (omp_test_lock(&l))
+                return;
+            conflict();
+            manager.lock(l);
+        }
+    };
+
+    template <typename Instr = instrumentation::None, typename Backoff = backoff::None,
+              typename Payload = payload::None, typename Size = sizing::Shared>
+    class BasicQueue : public BaseQueue
+    {
+        alignas(64) std::atomic<Mode> mode{Mode::Locked};
+
+        std::vector<Slot> slots;
+        Watch<Backoff> watch;
+        alignas(64) omp_lock_t lock; // of the locked representation
+        seq::BasicQueue<Instr, backoff::None, Payload> locked;
+        lock_free_aba::BasicQueue<Instr, Watch<Backoff>, Payload, Size> lock_free;
+        Instr instr;
+
+        // Decider state, only touched while holding decider
+        alignas(64) omp_lock_t decider;
+        double window_start{};
+        uint64_t window_ops{};
+        uint64_t window_conflicts{};
+        double throughput[2]{-1.0, -1.0}; // last window of each representation
+        bool probing{false};
+        unsigned hold{0};
+        unsigned hold_length{1};
+
+        static size_t index(Mode m) { return m == Mode::LockFree ? 1 : 0; }
+        static Mode other(Mode m) { return m == Mode::LockFree ? Mode::Locked : Mode::LockFree; }
+
+        // Runs op(mode) with the mode fixed for its whole duration
+        template <typename Op>
+        auto run(Op op)
+        {
+            Slot &mine = slots[omp_get_thread_num()];
+            while (true)
+            {
+                Mode m = mode.load(std::memory_order_acquire);
+                if (m != Mode::Switching)
+                {
+                    mine.active.store(true, std::memory_order_seq_cst);
+                    if (mode.load(std::memory_order_seq_cst) == m)
+                    {
+                        auto to_rtn = op(m);
+                        mine.active.store(false, std::memory_order_release);
+                        bump(mine.ops);
+                        if (mine.ops.load(std::memory_order_relaxed) % check_every == 0)
+                            adapt();
+                        return to_rtn;
+                    }
+                    mine.active.store(false, std::memory_order_relaxed);
+                }
+                spin::until([&]
+                            { return mode.load(std::memory_order_acquire) != Mode::Switching; });
+            }
+        }
+
+        void adapt()
+        {
+            if (!omp_test_lock(&decider))
+                return;
+            double now = omp_get_wtime();
+            if (now - window_start >= interval_s)
+                decide(now);
+            omp_unset_lock(&decider);
+        }
+
+        // Operations and conflicts of all threads so far
+        std::pair<uint64_t, uint64_t> totals() const
+        {
+            uint64_t ops = 0, conflicts = 0;
+            for (auto const &s : slots)
+            {
+                ops += s.ops.load(std::memory_order_relaxed);
+                conflicts += s.conflicts.load(std::memory_order_relaxed);
+            }
+            return {ops, conflicts};
+        }
+
+        void start_window(double now)
+        {
+            window_start = now;
+            std::tie(window_ops, window_conflicts) = totals();
+        }
+
+        void decide(double now)
+        {
+            auto [ops, conflicts] = totals();
+            double elapsed = now - window_start;
+            uint64_t n = ops - window_ops;
+            double conflict_rate = n == 0 ? 0.0 : double(conflicts - window_conflicts) / double(n);
+            start_window(now);
+            if (n == 0)
+                return;
+
+            Mode m = mode.load(std::memory_order_relaxed);
+            double rate = double(n) / elapsed;
+            throughput[index(m)] = rate;
+
+            if (probing)
+            {
+                probing = false;
+                double before = throughput[index(other(m))];
+                if (rate < worse * before)
+                {
+                    hold_length = std::min(2 * hold_length, max_hold);
+                    hold = hold_length;
+                    switch_to(other(m));
+                    return;
+                }
+                hold_length = 1;
+            }
+
+            if (hold > 0)
+            {
+                --hold;
+                return;
+            }
+            bool move = m == Mode::Locked ? conflict_rate > lock_to_free : conflict_rate < free_to_lock;
+            if (move)
+            {
+                probing = true;
+                switch_to(other(m));
+            }
+        }
+
+        // Quiescent transition, see the top of the file
+        void switch_to(Mode next)
+        {
+            Mode from = mode.load(std::memory_order_relaxed);
+            mode.store(Mode::Switching, std::memory_order_seq_cst);
+            for (auto const &s : slots)
+                spin::until([&]
+                            { return !s.active.load(std::memory_order_seq_cst); });
+
+            omp_set_lock(&lock); // only get_size() can be around
+            if (from == Mode::Locked)
+                for (value_t v = locked.pop(); v != empty_val; v = locked.pop())
+                    lock_free.push(v);
+            else
+                for (value_t v = lock_free.pop(); v != empty_val; v = lock_free.pop())
+                    locked.push(v);
+            omp_unset_lock(&lock);
+
+            instr.switched();
+            start_window(omp_get_wtime());
+            mode.store(next, std::memory_order_release);
+        }
+
+    public:
+        explicit BasicQueue(Backoff backoff_policy = Backoff{})
+            : slots(size_t(omp_get_max_threads())),
+              watch{backoff_policy, slots.data()},
+              lock_free(watch)
+        {
+            omp_init_lock(&lock);
+            omp_init_lock(&decider);
+            start_window(omp_get_wtime());
+        }
+
+        ~BasicQueue()
+        {
+            omp_destroy_lock(&lock);
+            omp_destroy_lock(&decider);
+        }
+
+        BasicQueue(BasicQueue const &) = delete;
+        BasicQueue(BasicQueue &&) = delete;
+        BasicQueue &operator=(BasicQueue const &) = delete;
+        BasicQueue &operator=(BasicQueue &&) = delete;
+
+        bool push(value_t val) override
+        {
+            return run([&](Mode m)
+                       {
+                if (m == Mode::LockFree)
+                    return lock_free.push(val);
+                instr.acquire(lock, watch);
+                locked.push(val);
+                omp_unset_lock(&lock);
+                return true; });
+        }
+
+        value_t pop() override
+        {
+            return run([&](Mode m)
+                       {
+                if (m == Mode::LockFree)
+                    return lock_free.pop();
+                instr.acquire(lock, watch);
+                value_t to_rtn = locked.pop();
+                omp_unset_lock(&lock);
+                return to_rtn; });
+        }
+
+        // During a switch the elements are on their way, the size is an estimate
+        int get_size() override
+        {
+            if (mode.load(std::memory_order_acquire) == Mode::LockFree)
+                return lock_free.get_size();
+            omp_set_lock(&lock);
+            int to_rtn = locked.get_size();
+            omp_unset_lock(&lock);
+            return to_rtn;
+        }
+
+        std::optional<instrumentation::Contention> contention() const override
+        {
+            auto to_rtn = instr.contention();
+            if (to_rtn)
+            {
+                *to_rtn += *locked.contention();
+                *to_rtn += *lock_free.contention();
+            }
+            return to_rtn;
+        }
+
+        // Also restarts the decision window, the pause between repetitions
+        // is no throughput
+        void reset_contention() override
+        {
+            instr.reset();
+            locked.reset_contention();
+            lock_free.reset_contention();
+            start_window(omp_get_wtime());
+        }
+
+        // The free list of the locked representation is the last entry
+        std::optional<memory::Allocation> allocation() const override
+        {
+            auto to_rtn = lock_free.allocation();
+            auto l = locked.allocation();
+            if (to_rtn && l)
+            {
+                to_rtn->nodes_allocated += l->nodes_allocated;
+                to_rtn->free_nodes.push_back(l->free_total());
+                to_rtn->buffers_allocated += l->buffers_allocated;
+            }
+            return to_rtn;
+        }
+    };
+
+    using Queue = BasicQueue<>;
+}; // namespace hybrid
@@ -0,0 +1,203 @@
+/*
+Compile time instrumentation policies for the queue implementations.
+
+Every queue is a template over one of these policies and calls it at the
+points that tell how contended it is:
+
+  cas(ok)        : a CAS of the algorithm succeeded or failed
+  help()         : a thread finished someone else's operation (tail swing)
+  acquire(lock, backoff)
+                 : takes an omp lock through the backoff policy
+                   (backoff.hpp), counting acquisitions, the ones that had
+                   to wait and the cycles spent waiting
+  freelist(hit)  : a push found a node in its free list or had to allocate
+  eliminated(hit): a push offered its value in an elimination array and a
+                   pop took it, or it had to withdraw the offer
+  switched()     : an adaptive queue moved to its other representation
+
+None has empty inline members and compiles away completely. Counting keeps
+one cache line of counters per thread (indexed with omp_get_thread_num(), so
+build the queue after setting the team size) and sums them in contention().
+*/
+
+#pragma once
+#include <omp.h>
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+namespace instrumentation
+{
+    struct Contention
+    {
+        uint64_t cas_success{};
+        uint64_t cas_failures{};
+        uint64_t helping{};
+        uint64_t lock_acquisitions{};
+        uint64_t lock_contended{};
+        uint64_t lock_wait_cycles{};
+        uint64_t freelist_hits{};
+        uint64_t freelist_misses{};
+        uint64_t elimination_offers{};
+        uint64_t eliminations{};
+        uint64_t mode_switches{};
+
+        Contention &operator+=(Contention const &other)
+        {
+            cas_success += other.cas_success;
+            cas_failures += other.cas_failures;
+            helping += other.helping;
+            lock_acquisitions += other.lock_acquisitions;
+            lock_contended += other.lock_contended;
+            lock_wait_cycles += other.lock_wait_cycles;
+            freelist_hits += other.freelist_hits;
+            freelist_misses += other.freelist_misses;
+            elimination_offers += other.elimination_offers;
+            eliminations += other.eliminations;
+            mode_switches += other.mode_switches;
+            return *this;
+        }
+    };
+
+    inline std::array<std::string, 11> const names{
+        "cas_success", "cas_failures", "helping", "lock_acquisitions",
+        "lock_contended", "lock_wait_cycles", "freelist_hits", "freelist_misses",
+        "elimination_offers", "eliminations", "mode_switches"};
+
+    // Same order as names
+    inline std::array<uint64_t, 11> values(Contention const &c)
+    {
+        return {c.cas_success, c.cas_failures, c.helping, c.lock_acquisitions,
+                c.lock_contended, c.lock_wait_cycles, c.freelist_hits, c.freelist_misses,
+                c.elimination_offers, c.eliminations, c.mode_switches};
+    }
+
+    // Failed CASes over all CASes, -1 if the queue did none
+    inline double cas_failure_rate(Contention const &c)
+    {
+        uint64_t total = c.cas_success + c.cas_failures;
+        return total == 0 ? -1.0 : double(c.cas_failures) / double(total);
+    }
+
+    // CASes (failed ones included) per queue operation, -1 if the queue did
+    // none. The number lock free designs try to bring down.
+    inline double cas_per_op(Contention const &c, uint64_t operations)
+    {
+        uint64_t total = c.cas_success + c.cas_failures;
+        return total == 0 || operations == 0 ? -1.0 : double(total) / double(operations);
+    }
+
+    // Offers taken by a pop over all offers, -1 if there were none
+    inline double elimination_rate(Contention const &c)
+    {
+        return c.elimination_offers == 0 ? -1.0 : double(c.eliminations) / double(c.elimination_offers);
+    }
+
+    // TSC on x86, nanoseconds elsewhere
+    inline uint64_t cycles()
+    {
+#if defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+#else
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch())
+            .count();
+#endif
+    }
+
+    struct None
+    {
+        static constexpr bool enabled = false;
+
+        void cas(bool) {}
+        void help() {}
+        void freelist(bool) {}
+        void eliminated(bool) {}
+        void switched() {}
+        template <typename Backoff>
+        void acquire(omp_lock_t &lock, Backoff const &manager) { manager.lock(lock); }
+
+        void reset() {}
+        std::optional<Contention> contention() const { return std::nullopt; }
+    };
+
+    class Counting
+    {
+        struct alignas(64) Slot
+        {
+            Contention counts;
+        };
+        std::vector<Slot> slots;
+
+        Contention &mine() { return slots[omp_get_thread_num()].counts; }
+
+    public:
+        static constexpr bool enabled = true;
+
+        Counting() : slots(omp_get_max_threads()) {}
+
+        void cas(bool ok)
+        {
+            if (ok)
+                mine().cas_success++;
+            else
+                mine().cas_failures++;
+        }
+
+        void help() { mine().helping++; }
+
+        void freelist(bool hit)
+        {
+            if (hit)
+                mine().freelist_hits++;
+            else
+                mine().freelist_misses++;
+        }
+
+        void eliminated(bool hit)
+        {
+            mine().elimination_offers++;
+            if (hit)
+                mine().eliminations++;
+        }
+
+        void switched() { mine().mode_switches++; }
+
+        template <typename Backoff>
+        void acquire(omp_lock_t &lock, Backoff const &manager)
+        {
+            Contention &c = mine();
+            c.lock_acquisitions++;
+            if (omp_test_lock(&lock))
+                return;
+
+            uint64_t start = cycles();
+            manager.lock(lock);
+            c.lock_contended++;
+            c.lock_wait_cycles += cycles() - start;
+        }
+
+        // Only call while no thread uses the queue
+        void reset()
+        {
+            for (auto &slot : slots)
+                slot.counts = Contention{};
+        }
+
+        std::optional<Contention> contention() const
+        {
+            Contention to_rtn{};
+            for (auto const &slot : slots)
+                to_rtn += slot.counts;
+            return to_rtn;
+        }
+    };
+}; // namespace instrumentation
@@ -0,0 +1,287 @@
+/*
+Minimal helpers to write the JSON records of the benchmark results, and a
+small parser to read them back (e.g. a baseline for --compare). The
+parser covers what save_results writes: no \u escapes beyond ASCII, numbers
+as double.
+*/
+
+#pragma once
+#include <algorithm>
+#include <cstdlib>
+#include <initializer_list>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace json
+{
+    inline std::string quote(std::string const &s)
+    {
+        std::string to_rtn = "\"";
+        for (char c : s)
+        {
+            switch (c)
+            {
+            case '"':
+                to_rtn += "\\\"";
+                break;
+            case '\\':
+                to_rtn += "\\\\";
+                break;
+            case '\n':
+                to_rtn += "\\n";
+                break;
+            case '\t':
+                to_rtn += "\\t";
+                break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20)
+                    to_rtn += ' ';
+                else
+                    to_rtn += c;
+            }
+        }
+        return to_rtn + "\"";
+    }
+
+    template <typename T>
+    void write_array(std::ostream &out, std::vector<T> const &values)
+    {
+        out << "[";
+        for (size_t i = 0; i < values.size(); ++i)
+            out << (i ? "," : "") << values[i];
+        out << "]";
+    }
+
+    struct Value
+    {
+        enum class Type
+        {
+            Null,
+            Bool,
+            Number,
+            String,
+            Array,
+            Object
+        };
+
+        Type type{Type::Null};
+        bool boolean{};
+        double number{};
+        std::string string;
+        std::vector<Value> array;
+        std::vector<std::pair<std::string, Value>> object; // in file order
+
+        // nullptr if this is not an object or has no such key
+        Value const *find(std::string_view key) const
+        {
+            for (auto const &[k, v] : object)
+                if (k == key)
+                    return &v;
+            return nullptr;
+        }
+
+        // Follows a path of object keys, nullptr if any step is missing
+        Value const *at_path(std::initializer_list<std::string_view> path) const
+        {
+            Value const *to_rtn = this;
+            for (auto key : path)
+                if (!to_rtn || !(to_rtn = to_rtn->find(key)))
+                    return nullptr;
+            return to_rtn;
+        }
+
+        double number_or(std::string_view key, double fallback) const
+        {
+            Value const *v = find(key);
+            return v && v->type == Type::Number ? v->number : fallback;
+        }
+
+        std::string string_or(std::string_view key, std::string fallback) const
+        {
+            Value const *v = find(key);
+            return v && v->type == Type::String ? v->string : fallback;
+        }
+
+        bool bool_or(std::string_view key, bool fallback) const
+        {
+            Value const *v = find(key);
+            return v && v->type == Type::Bool ? v->boolean : fallback;
+        }
+
+        template <typename T>
+        std::vector<T> numbers(std::string_view key) const
+        {
+            std::vector<T> to_rtn;
+            if (Value const *v = find(key))
+                for (auto const &e : v->array)
+                    if (e.type == Type::Number)
+                        to_rtn.push_back(T(e.number));
+            return to_rtn;
+        }
+    };
+
+    class Parser
+    {
+        std::string_view text;
+        size_t pos = 0;
+
+        void skip_space()
+        {
+            while (pos < text.size() && (text[pos] == ' ' || text[pos] == '\n' ||
+                                         text[pos] == '\r' || text[pos] == '\t'))
+                ++pos;
+        }
+
+        bool consume(char c)
+        {
+            skip_space();
+            if (pos < text.size() && text[pos] == c)
+            {
+                ++pos;
+                return true;
+            }
+            return false;
+        }
+
+        bool literal(std::string_view word)
+        {
+            if (text.substr(pos, word.size()) != word)
+                return false;
+            pos += word.size();
+            return true;
+        }
+
+        bool parse_string(std::string &out)
+        {
+            if (!consume('"'))
+                return false;
+            while (pos < text.size() && text[pos] != '"')
+            {
+                char c = text[pos++];
+                if (c != '\\')
+                {
+                    out += c;
+                    continue;
+                }
+                if (pos >= text.size())
+                    return false;
+                switch (char e = text[pos++])
+                {
+                case 'n':
+                    out += '\n';
+                    break;
+                case 't':
+                    out += '\t';
+                    break;
+                case 'r':
+                    out += '\r';
+                    break;
+                case 'b':
+                    out += '\b';
+                    break;
+                case 'f':
+                    out += '\f';
+                    break;
+                case 'u':
+                {
+                    if (pos + 4 > text.size())
+                        return false;
+                    long code = std::strtol(std::string(text.substr(pos, 4)).c_str(), nullptr, 16);
+                    out += code < 0x80 ? char(code) : '?';
+                    pos += 4;
+                    break;
+                }
+                default:
+                    out += e;
+                }
+            }
+            return consume('"');
+        }
+
+        bool parse_value(Value &out)
+        {
+            skip_space();
+            if (pos >= text.size())
+                return false;
+
+            char c = text[pos];
+            if (c == '{')
+            {
+                ++pos;
+                out.type = Value::Type::Object;
+                if (consume('}'))
+                    return true;
+                do
+                {
+                    std::string key;
+                    Value v;
+                    if (!parse_string(key) || !consume(':') || !parse_value(v))
+                        return false;
+                    out.object.emplace_back(std::move(key), std::move(v));
+                } while (consume(','));
+                return consume('}');
+            }
+            if (c == '[')
+            {
+                ++pos;
+                out.type = Value::Type::Array;
+                if (consume(']'))
+                    return true;
+                do
+                {
+                    Value v;
+                    if (!parse_value(v))
+                        return false;
+                    out.array.push_back(std::move(v));
+                } while (consume(','));
+                return consume(']');
+            }
+            if (c == '"')
+            {
+                out.type = Value::Type::String;
+                return parse_string(out.string);
+            }
+            if (literal("true") || literal("false"))
+            {
+                out.type = Value::Type::Bool;
+                out.boolean = c == 't';
+                return true;
+            }
+            if (literal("null"))
+                return true;
+
+            std::string number(text.substr(pos, std::min<size_t>(64, text.size() - pos)));
+            char *end = nullptr;
+            out.number = std::strtod(number.c_str(), &end);
+            if (end == number.c_str())
+                return false;
+            out.type = Value::Type::Number;
+            pos += size_t(end - number.c_str());
+            return true;
+        }
+
+    public:
+        explicit Parser(std::string_view t) : text(t) {}
+
+        std::optional<Value> parse()
+        {
+            Value to_rtn;
+            if (!parse_value(to_rtn))
+                return std::nullopt;
+            skip_space();
+            if (pos != text.size())
+                return std::nullopt;
+            return to_rtn;
+        }
+    };
+
+    // nullopt if text is not exactly one JSON value
+    inline std::optional<Value> parse(std::string_view text)
+    {
+        return Parser(text).parse();
+    }
+}; // namespace json
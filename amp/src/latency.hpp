@@ -0,0 +1,93 @@
+/*
+Per operation latency histograms.
+
+Reading the clock around every push and pop would cost more than most of
+the operations themselves, so only every n-th operation of a thread is
+timed (Sampler). The latencies go into log2 buckets: bucket b counts
+latencies in [2^(b-1), 2^b) ns, bucket 0 the ones below 1 ns. The
+histogram is a plain array, kept in the per thread Counter, so it needs no
+allocation and can be handed out as is.
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+
+namespace latency
+{
+    inline constexpr size_t n_buckets = 64;
+
+    struct Histogram
+    {
+        std::array<uint64_t, n_buckets> buckets{};
+
+        void add(uint64_t ns) { buckets[std::min<size_t>(std::bit_width(ns), n_buckets - 1)]++; }
+
+        uint64_t count() const
+        {
+            uint64_t to_rtn = 0;
+            for (uint64_t b : buckets)
+                to_rtn += b;
+            return to_rtn;
+        }
+
+        Histogram &operator+=(Histogram const &other)
+        {
+            for (size_t b = 0; b < n_buckets; ++b)
+                buckets[b] += other.buckets[b];
+            return *this;
+        }
+
+        // Upper bound in ns of the bucket holding quantile q, -1 if empty
+        double quantile(double q) const
+        {
+            uint64_t total = count();
+            if (total == 0)
+                return -1.0;
+            uint64_t rank = uint64_t(q * double(total - 1));
+            uint64_t seen = 0;
+            for (size_t b = 0; b < n_buckets; ++b)
+            {
+                seen += buckets[b];
+                if (seen > rank)
+                    return upper_bound(b);
+            }
+            return upper_bound(n_buckets - 1);
+        }
+
+        static double upper_bound(size_t bucket) { return double(uint64_t(1) << bucket); }
+    };
+
+    inline uint64_t now_ns()
+    {
+        return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                            std::chrono::steady_clock::now().time_since_epoch())
+                            .count());
+    }
+
+    // Times every n-th call of one thread, n = 0 disables it
+    class Sampler
+    {
+        size_t every;
+        size_t left;
+
+    public:
+        explicit Sampler(size_t n) : every(n), left(n) {}
+
+        template <typename Op>
+        auto operator()(Histogram &histogram, Op &&op)
+        {
+            if (every == 0 || --left != 0)
+                return op();
+            left = every;
+            uint64_t start = now_ns();
+            auto to_rtn = op();
+            histogram.add(now_ns() - start);
+            return to_rtn;
+        }
+    };
+}; // namespace latency
@@ -1,24 +1,164 @@
 #include "benchmark.hpp"
 #include "fine_lock.hpp"
-#include "lock_free_aba.hpp"
+#include "lockbench.hpp"
+#include "queues.hpp"
+#include "regression.hpp"
+#include "sweep.hpp"
 #include "timer.hpp"
+#include "trace.hpp"
+#include <cmath>
 #include <iostream>
 #include <map>
 #include <memory>
+#include <optional>
+#include <sstream>
+
+std::vector<std::string> split(std::string const &list, char delimiter = ',')
+{
+    std::vector<std::string> to_rtn;
+    std::stringstream ss(list);
+    std::string item;
+    while (std::getline(ss, item, delimiter))
+        if (!item.empty())
+            to_rtn.push_back(item);
+    return to_rtn;
+}
+
+// Thread count, either absolute ("4") or a multiple of the cpus this process
+// may run on ("2x", "0.5x"), the latter for oversubscribed runs
+int parse_threads(std::string const &value)
+{
+    if (!value.empty() && value.back() == 'x')
+        return int(std::lround(std::stod(value.substr(0, value.size() - 1)) * affinity::online_cpus()));
+    return std::stoi(value);
+}
+
+std::map<std::string, ConfigRecipe> const config_recipe_map{
+    {"balanced", ConfigRecipe::Balanced},
+    {"thread", ConfigRecipe::ThreadSpecific}};
+
+std::map<std::string, sweep::Order> const sweep_order_map{
+    {"sequential", sweep::Order::Sequential},
+    {"interleaved", sweep::Order::Interleaved},
+    {"random", sweep::Order::Random}};
 
 struct Arguments
 {
     std::string config_recipe{"balanced"};
     int max_time{1};
+    double warmup{0.0};
     int sets{0};
     int seed{42};
     int repetitions{1};
     int n_threads{1};
     std::string type{"sequential"};
-    bool is_safe_run{false};
-    bool cache_checks{false};
+    std::string placement{"none"};
+    std::string cpus{};
+    std::string output{};
+    bool verify{false}; // per producer sequence verification in run_fast
+    bool contention{false}; // build the queue with instrumentation::Counting
+    std::string backoff{"none"}; // on contended locks and failed CASes of the queues
+    int backoff_min_spins{4};    // exponential and randomized backoff
+    int backoff_max_spins{1024};
+    int payload{0};               // bytes of message per element, 0 for the value only
+    std::string payload_mode{"inline"};
+    std::string size_tracking{"shared"}; // size counter of the concurrent queues (sizing.hpp)
+    bool perf_counters{false};
+    bool check_linearizability{false};
+    int history_capacity{1 << 20};
+    double telemetry{0.0}; // sampling interval in ms, 0 = off
+    int telemetry_capacity{4096};
+    std::string telemetry_output{};
+    int latency_sample{0}; // time every n-th operation, 0 = off
+    std::string record_trace{}; // write the operations of the run to this trace
+    int trace_capacity{1 << 20}; // records per thread
+    std::string replay{};       // replay this trace instead of the generated batches
+    bool replay_gaps{false};
+    bool hwbench{false};      // characterize the machine and store it with the records
+    bool hwbench_only{false}; // only print the characterization
+    std::string hwbench_cpus{}; // cpus of the ping-pong matrix, default all
+
+    // Regression gate, reruns every record of this results file
+    std::string compare{};
+    double threshold{0.05};
+    double alpha{0.05};
+
+    // Lock benchmark, runs over threads_list
+    bool lockbench{false};
+    std::string locks{"peterson,filter,bakery,tas,ttas,ticket,mcs,std_mutex,omp_lock"};
     bool print_header{false};
 
+    // Sweep mode, comma separated lists
+    bool sweep{false};
+    std::string types{"global_lock,fine_lock,lock_free"};
+    std::string threads_list{"1,2,4,8"};
+    std::string recipes{"balanced"};
+    std::string batch_sizes{"0"};
+    std::string payloads{""}; // defaults to --payload
+    std::string order{"sequential"};
+    int predict_threads{0}; // fitted throughput at this thread count
+
+    bool are_sweep_args_valid() const
+    {
+        for (auto const &t : split(types))
+            if (!queues::exists(t))
+            {
+                std::cerr << "Error: unknown queue type in --types: " << t << std::endl;
+                return false;
+            }
+        for (auto const &r : split(recipes))
+            if (config_recipe_map.count(r) == 0)
+            {
+                std::cerr << "Error: unknown recipe in --recipes: " << r << std::endl;
+                return false;
+            }
+        if (sweep_order_map.count(order) == 0)
+        {
+            std::cerr << "Error: order must be 'sequential', 'interleaved' or 'random', got: "
+                      << order << std::endl;
+            return false;
+        }
+        if (predict_threads < 0)
+        {
+            std::cerr << "Error: predict_threads must be >= 0" << std::endl;
+            return false;
+        }
+        try
+        {
+            for (auto const &n : split(threads_list))
+                if (parse_threads(n) <= 0)
+                {
+                    std::cerr << "Error: thread counts must be > 0" << std::endl;
+                    return false;
+                }
+            for (auto const &b : split(batch_sizes))
+                if (std::stoi(b) < 0)
+                {
+                    std::cerr << "Error: batch sizes must be >= 0" << std::endl;
+                    return false;
+                }
+            for (auto const &p : split(payloads))
+                if (!payload::supported(size_t(std::stoul(p))))
+                {
+                    std::cerr << "Error: payload sizes must be 0, 64, 256 or 1024, got: " << p << std::endl;
+                    return false;
+                }
+        }
+        catch (const std::exception &e)
+        {
+            std::cerr << "Error: --threads_list, --batch_sizes and --payloads take comma separated integers"
+                         " (thread counts also Nx, N times the cpus)" << std::endl;
+            return false;
+        }
+        if (split(types).empty() || split(threads_list).empty() ||
+            split(recipes).empty() || split(batch_sizes).empty())
+        {
+            std::cerr << "Error: sweep lists must not be empty" << std::endl;
+            return false;
+        }
+        return true;
+    }
+
     bool are_valid() const
     {
         // Validate config_recipe
@@ -30,10 +170,39 @@ struct Arguments
         }
 
         // Validate type
-        if (type != "global_lock" && type != "fine_lock" && type != "lock_free" && type !="sequential")
+        if (!sweep && !queues::exists(type))
+        {
+            std::cerr << "Error: type must be one of";
+            for (auto const &name : queues::names())
+                std::cerr << " '" << name << "'";
+            std::cerr << ", got: " << type << std::endl;
+            return false;
+        }
+
+        if (sweep && !are_sweep_args_valid())
+            return false;
+
+        affinity::Placement tmp;
+        if (!affinity::from_string(placement, tmp))
+        {
+            std::cerr << "Error: placement must be 'none', 'compact', 'scatter', 'smt_pairs' or 'list', got: "
+                      << placement << std::endl;
+            return false;
+        }
+
+        if (placement == "list" && cpus.empty())
+        {
+            std::cerr << "Error: placement 'list' needs --cpus, e.g. --cpus 0-3,8" << std::endl;
+            return false;
+        }
+
+        try
+        {
+            affinity::parse_cpu_list(cpus);
+        }
+        catch (const std::exception &e)
         {
-            std::cerr << "Error: type must be 'global_lock', 'fine_lock', or 'lock_free', got: "
-                      << type << std::endl;
+            std::cerr << "Error: cpus must look like 0-3,8, got: " << cpus << std::endl;
             return false;
         }
 
@@ -43,6 +212,11 @@ struct Arguments
             std::cerr << "Error: max_time must be >= 0, got: " << max_time << std::endl;
             return false;
         }
+        if (warmup < 0)
+        {
+            std::cerr << "Error: warmup must be >= 0, got: " << warmup << std::endl;
+            return false;
+        }
         if (sets < 0)
         {
             std::cerr << "Error: sets must be >= 0, got: " << max_time << std::endl;
@@ -55,33 +229,158 @@ struct Arguments
             return false;
         }
 
-        if (sets != 0 && is_safe_run)
+        if (sets != 0 && verify)
         {
-            std::cerr << " Safe run can only run in a time based benchmark. Use e.g --max_time 1 --sets 0" << std::endl;
+            std::cerr << " Verification can only run in a time based benchmark. Use e.g --max_time 1 --sets 0" << std::endl;
             return false;
         }
 
-        if (is_safe_run && cache_checks)
+        if (check_linearizability && (verify || sets != 0 || sweep))
         {
-            std::cerr << "Safe run and cahce checks cannot be used at the same time. First do a benchmark with safe run and then cache checks. The reason is that safe run introduces overheads that will produce false resutls for the cache hits." << std::endl;
+            std::cerr << "Error: check_linearizability is its own time based run mode" << std::endl;
+            return false;
         }
 
-        if (repetitions <= 0)
+        if (check_linearizability && queues::is_priority(type))
         {
-            std::cerr << "Error: repetitions must be > 0, got: " << repetitions << std::endl;
+            std::cerr << "Error: check_linearizability checks FIFO order, " << type
+                      << " is a priority queue" << std::endl;
             return false;
         }
 
-        if (n_threads <= 0)
+        if (telemetry < 0 || telemetry_capacity <= 0)
         {
-            std::cerr << "Error: n_threads must be > 0, got: " << n_threads << std::endl;
+            std::cerr << "Error: telemetry must be >= 0 and telemetry_capacity > 0" << std::endl;
+            return false;
+        }
+
+        if (!telemetry_output.empty() && telemetry == 0)
+        {
+            std::cerr << "Error: telemetry_output needs a sampling interval, e.g. --telemetry 10" << std::endl;
             return false;
         }
 
-        // Validate cache_checks constraint
-        if (cache_checks && type != "lock_free")
+        if (latency_sample < 0)
         {
-            std::cerr << "Error: cache_checks can only be used with type='lock_free'" << std::endl;
+            std::cerr << "Error: latency_sample must be >= 0" << std::endl;
+            return false;
+        }
+
+        if (lockbench)
+        {
+            for (auto const &l : split(locks))
+                if (lockbench::registry().count(l) == 0)
+                {
+                    std::cerr << "Error: unknown lock in --locks: " << l << std::endl;
+                    return false;
+                }
+            if (sweep || max_time <= 0)
+            {
+                std::cerr << "Error: lockbench is its own time based run mode" << std::endl;
+                return false;
+            }
+            try
+            {
+                for (auto const &n : split(threads_list))
+                    if (parse_threads(n) <= 0)
+                    {
+                        std::cerr << "Error: thread counts must be > 0, got: " << n << std::endl;
+                        return false;
+                    }
+            }
+            catch (const std::exception &e)
+            {
+                std::cerr << "Error: --threads_list takes comma separated integers or Nx" << std::endl;
+                return false;
+            }
+        }
+
+        if (payload < 0 || !payload::supported(size_t(payload)))
+        {
+            std::cerr << "Error: payload must be 0, 64, 256 or 1024, got: " << payload << std::endl;
+            return false;
+        }
+
+        payload::Mode mode;
+        if (!payload::from_string(payload_mode, mode))
+        {
+            std::cerr << "Error: payload_mode must be 'inline' or 'pooled', got: " << payload_mode << std::endl;
+            return false;
+        }
+
+        sizing::Kind tracking;
+        if (!sizing::from_string(size_tracking, tracking))
+        {
+            std::cerr << "Error: size_tracking must be 'shared', 'none', 'sharded' or 'tickets', got: "
+                      << size_tracking << std::endl;
+            return false;
+        }
+
+        backoff::Kind kind;
+        if (!backoff::from_string(backoff, kind))
+        {
+            std::cerr << "Error: backoff must be 'none', 'spin_yield', 'exponential' or 'randomized', got: "
+                      << backoff << std::endl;
+            return false;
+        }
+
+        if (backoff_min_spins <= 0 || backoff_min_spins > backoff_max_spins)
+        {
+            std::cerr << "Error: backoff needs 0 < backoff_min_spins <= backoff_max_spins" << std::endl;
+            return false;
+        }
+
+        if (!compare.empty() && (sweep || lockbench || !replay.empty() || check_linearizability))
+        {
+            std::cerr << "Error: compare is its own run mode, the configs come from the baseline" << std::endl;
+            return false;
+        }
+
+        if (threshold < 0 || alpha <= 0 || alpha >= 1)
+        {
+            std::cerr << "Error: threshold must be >= 0 and alpha in (0, 1)" << std::endl;
+            return false;
+        }
+
+        if (!hwbench_cpus.empty() && affinity::parse_cpu_list(hwbench_cpus).empty())
+        {
+            std::cerr << "Error: hwbench_cpus must look like 0-3,8, got: " << hwbench_cpus << std::endl;
+            return false;
+        }
+
+        if (trace_capacity <= 0)
+        {
+            std::cerr << "Error: trace_capacity must be > 0, got: " << trace_capacity << std::endl;
+            return false;
+        }
+
+        if (!replay.empty() && (verify || check_linearizability || sets != 0 || sweep))
+        {
+            std::cerr << "Error: replay is its own run mode, every pass is cut at --max_time" << std::endl;
+            return false;
+        }
+
+        if (!record_trace.empty() && sweep)
+        {
+            std::cerr << "Error: record_trace records a single run, not a sweep" << std::endl;
+            return false;
+        }
+
+        if (history_capacity <= 0)
+        {
+            std::cerr << "Error: history_capacity must be > 0, got: " << history_capacity << std::endl;
+            return false;
+        }
+
+        if (repetitions <= 0)
+        {
+            std::cerr << "Error: repetitions must be > 0, got: " << repetitions << std::endl;
+            return false;
+        }
+
+        if (n_threads <= 0)
+        {
+            std::cerr << "Error: n_threads must be > 0, got: " << n_threads << std::endl;
             return false;
         }
 
@@ -119,6 +418,14 @@ Arguments parse(int argc, char *argv[])
                     args.max_time = std::stoi(val);
                 }
             }
+            else if (arg == "--warmup")
+            {
+                std::string val = get_next_value();
+                if (!val.empty())
+                {
+                    args.warmup = std::stod(val);
+                }
+            }
             else if (arg == "--seed")
             {
                 std::string val = get_next_value();
@@ -148,20 +455,209 @@ Arguments parse(int argc, char *argv[])
                 std::string val = get_next_value();
                 if (!val.empty()) // FIXED: Added empty check
                 {
-                    args.n_threads = std::stoi(val);
+                    args.n_threads = parse_threads(val);
                 }
             }
+            else if (arg == "--placement")
+            {
+                args.placement = get_next_value();
+            }
+            else if (arg == "--cpus")
+            {
+                args.cpus = get_next_value();
+                args.placement = "list";
+            }
             else if (arg == "--type")
             {
                 args.type = get_next_value();
             }
-            else if (arg == "--is_safe_run")
+            else if (arg == "--verify" || arg == "--is_safe_run")
+            {
+                args.verify = true;
+            }
+            else if (arg == "--contention" || arg == "--cache_checks")
+            {
+                args.contention = true;
+            }
+            else if (arg == "--backoff")
+            {
+                args.backoff = get_next_value();
+            }
+            else if (arg == "--backoff_min_spins")
+            {
+                std::string val = get_next_value();
+                if (!val.empty())
+                {
+                    args.backoff_min_spins = std::stoi(val);
+                }
+            }
+            else if (arg == "--backoff_max_spins")
+            {
+                std::string val = get_next_value();
+                if (!val.empty())
+                {
+                    args.backoff_max_spins = std::stoi(val);
+                }
+            }
+            else if (arg == "--payload")
+            {
+                std::string val = get_next_value();
+                if (!val.empty())
+                {
+                    args.payload = std::stoi(val);
+                }
+            }
+            else if (arg == "--payload_mode")
+            {
+                args.payload_mode = get_next_value();
+            }
+            else if (arg == "--size_tracking")
+            {
+                args.size_tracking = get_next_value();
+            }
+            else if (arg == "--payloads")
+            {
+                args.payloads = get_next_value();
+            }
+            else if (arg == "--output")
+            {
+                args.output = get_next_value();
+            }
+            else if (arg == "--check_linearizability")
+            {
+                args.check_linearizability = true;
+            }
+            else if (arg == "--history_capacity")
+            {
+                std::string val = get_next_value();
+                if (!val.empty())
+                {
+                    args.history_capacity = std::stoi(val);
+                }
+            }
+            else if (arg == "--telemetry")
+            {
+                std::string val = get_next_value();
+                if (!val.empty())
+                {
+                    args.telemetry = std::stod(val);
+                }
+            }
+            else if (arg == "--telemetry_capacity")
+            {
+                std::string val = get_next_value();
+                if (!val.empty())
+                {
+                    args.telemetry_capacity = std::stoi(val);
+                }
+            }
+            else if (arg == "--telemetry_output")
+            {
+                args.telemetry_output = get_next_value();
+            }
+            else if (arg == "--latency_sample")
             {
-                args.is_safe_run = true;
+                std::string val = get_next_value();
+                if (!val.empty())
+                {
+                    args.latency_sample = std::stoi(val);
+                }
+            }
+            else if (arg == "--record_trace")
+            {
+                args.record_trace = get_next_value();
             }
-            else if (arg == "--cache_checks")
+            else if (arg == "--trace_capacity")
             {
-                args.cache_checks = true;
+                std::string val = get_next_value();
+                if (!val.empty())
+                {
+                    args.trace_capacity = std::stoi(val);
+                }
+            }
+            else if (arg == "--replay")
+            {
+                args.replay = get_next_value();
+            }
+            else if (arg == "--replay_gaps")
+            {
+                args.replay_gaps = true;
+            }
+            else if (arg == "--hwbench")
+            {
+                args.hwbench = true;
+            }
+            else if (arg == "--hwbench_only")
+            {
+                args.hwbench_only = true;
+            }
+            else if (arg == "--hwbench_cpus")
+            {
+                args.hwbench_cpus = get_next_value();
+            }
+            else if (arg == "--compare")
+            {
+                args.compare = get_next_value();
+            }
+            else if (arg == "--threshold")
+            {
+                std::string val = get_next_value();
+                if (!val.empty())
+                {
+                    args.threshold = std::stod(val);
+                }
+            }
+            else if (arg == "--alpha")
+            {
+                std::string val = get_next_value();
+                if (!val.empty())
+                {
+                    args.alpha = std::stod(val);
+                }
+            }
+            else if (arg == "--lockbench")
+            {
+                args.lockbench = true;
+            }
+            else if (arg == "--locks")
+            {
+                args.locks = get_next_value();
+            }
+            else if (arg == "--perf")
+            {
+                args.perf_counters = true;
+            }
+            else if (arg == "--sweep")
+            {
+                args.sweep = true;
+            }
+            else if (arg == "--types")
+            {
+                args.types = get_next_value();
+            }
+            else if (arg == "--threads_list")
+            {
+                args.threads_list = get_next_value();
+            }
+            else if (arg == "--recipes")
+            {
+                args.recipes = get_next_value();
+            }
+            else if (arg == "--batch_sizes")
+            {
+                args.batch_sizes = get_next_value();
+            }
+            else if (arg == "--predict_threads")
+            {
+                std::string val = get_next_value();
+                if (!val.empty())
+                {
+                    args.predict_threads = std::stoi(val);
+                }
+            }
+            else if (arg == "--order")
+            {
+                args.order = get_next_value();
             }
             else if (arg == "--print_header")
             {
@@ -198,81 +694,231 @@ int main(int argc, char *argv[])
         return 1;
     }
 
-    // FIXED: Safe map access with validation
-    std::map<std::string, ConfigRecipe> config_recipe_map{
-        {"balanced", ConfigRecipe::Balanced},
-        {"thread", ConfigRecipe::ThreadSpecific}};
+    std::optional<hwbench::Characterization> hardware;
+    if (args.hwbench || args.hwbench_only)
+    {
+        hardware = hwbench::run(affinity::parse_cpu_list(args.hwbench_cpus));
+        hwbench::print(std::cerr, *hardware);
+        if (args.hwbench_only)
+            return 0;
+    }
 
-    // This is now safe because are_valid() checks config_recipe
-    Config config = ConfigFactory{
-        args.n_threads,
-        args.repetitions,
-        args.max_time,
-        args.sets,
-        args.seed,
-        config_recipe_map[args.config_recipe]}();
+    if (!args.compare.empty())
+    {
+        std::string error;
+        std::vector<regression::Baseline> baselines = regression::load(args.compare, error);
+        if (!error.empty())
+        {
+            std::cerr << "Error: " << error << std::endl;
+            return 1;
+        }
 
-    Benchmark benchmark{std::move(config)};
+        regression::Options options{args.threshold, args.alpha};
+        std::vector<regression::Verdict> verdicts;
+        for (auto const &b : baselines)
+            verdicts.push_back(regression::compare(b, options, hardware ? &*hardware : nullptr, args.output));
+        regression::print(std::cout, verdicts, options);
 
-    std::unique_ptr<BaseQueue> queue;
-    if (args.type == "global_lock")
-    {
-        queue = std::make_unique<global_lock::Queue>();
+        bool regressed = std::any_of(verdicts.begin(), verdicts.end(),
+                                     [](auto const &v) { return v.regressed(); });
+        return regressed ? 2 : 0;
     }
-    else if (args.type == "fine_lock")
+
+    if (args.lockbench)
     {
-        queue = std::make_unique<fine_lock::Queue>();
+        affinity::Placement placement{};
+        affinity::from_string(args.placement, placement);
+        std::vector<int> cpus = affinity::cpu_order(placement, affinity::parse_cpu_list(args.cpus));
+
+        bool header = args.print_header;
+        bool broken = false;
+        for (auto const &threads : split(args.threads_list))
+            for (auto const &name : split(args.locks))
+            {
+                int n = parse_threads(threads);
+                auto const &[max_threads, runner] = lockbench::registry().at(name);
+                if (n > max_threads)
+                    continue;
+                lockbench::Result r = runner(n, args.max_time, cpus);
+                lockbench::print_csv(r, header);
+                header = false;
+                broken = broken || !r.mutual_exclusion;
+                if (!args.output.empty())
+                    lockbench::save(args.output, r, args.max_time);
+            }
+        return broken ? 2 : 0;
     }
-    else if (args.type == "lock_free")
+
+    if (args.sweep)
     {
-        queue = std::make_unique<lock_free_aba::Queue>();
+        sweep::Spec spec;
+        spec.types = split(args.types);
+        for (auto const &n : split(args.threads_list))
+            spec.threads.push_back(parse_threads(n));
+        for (auto const &r : split(args.recipes))
+        {
+            spec.recipes.push_back(config_recipe_map.at(r));
+            spec.recipe_names.push_back(r);
+        }
+        spec.batch_sizes.clear();
+        for (auto const &b : split(args.batch_sizes))
+            spec.batch_sizes.push_back(std::stoi(b));
+        spec.order = sweep_order_map.at(args.order);
+        spec.repetitions = args.repetitions;
+        spec.max_time_in_s = args.max_time;
+        spec.sets = args.sets;
+        spec.seed = args.seed;
+        spec.warmup_time_in_s = args.warmup;
+        spec.perf_counters = args.perf_counters;
+        spec.verify = args.verify;
+        spec.contention = args.contention;
+        backoff::from_string(args.backoff, spec.backoff);
+        spec.backoff_parameters = {unsigned(args.backoff_min_spins), unsigned(args.backoff_max_spins)};
+        payload::from_string(args.payload_mode, spec.payload_mode);
+        sizing::from_string(args.size_tracking, spec.size_tracking);
+        spec.payload_sizes = {size_t(args.payload)};
+        if (!args.payloads.empty())
+        {
+            spec.payload_sizes.clear();
+            for (auto const &p : split(args.payloads))
+                spec.payload_sizes.push_back(size_t(std::stoul(p)));
+        }
+        spec.telemetry_interval_ms = args.telemetry;
+        spec.telemetry_capacity = size_t(args.telemetry_capacity);
+        spec.telemetry_output = args.telemetry_output;
+        spec.latency_sample = size_t(args.latency_sample);
+        spec.predict_threads = args.predict_threads;
+        spec.hardware = hardware ? &*hardware : nullptr;
+        affinity::from_string(args.placement, spec.placement);
+        spec.cpu_list = affinity::parse_cpu_list(args.cpus);
+
+        size_t skipped = sweep::run(spec, args.print_header, args.output);
+        if (skipped != 0)
+            std::cerr << skipped << " points of the sweep were skipped" << std::endl;
+        return 0;
     }
-    else if (args.type == "sequential")
+
+    // A replay runs one thread per thread of the trace
+    std::optional<trace::Mapped> replay;
+    if (!args.replay.empty())
     {
-        // std::cout<<"Sequential mode"<<args.n_threads<<std::endl;
-        if(args.n_threads!=1){
-            std::cerr<<" n_threads>1 in sequential benchmark !!!"<<std::endl;
-            std::abort();
+        replay.emplace(args.replay);
+        if (!replay->ok())
+        {
+            std::cerr << "Error: " << replay->error() << std::endl;
+            return 1;
         }
-        queue = std::make_unique<seq::Queue>();
+        args.n_threads = int(replay->n_threads());
+        args.config_recipe = "balanced"; // the batches are not used, any valid recipe does
     }
-    else
+
+    // This is now safe because are_valid() checks config_recipe
+    Config config = ConfigFactory{
+        args.n_threads,
+        args.repetitions,
+        args.max_time,
+        args.sets,
+        args.seed,
+        config_recipe_map.at(args.config_recipe)}();
+    config.warmup_time_in_s = args.warmup;
+    config.perf_counters = args.perf_counters;
+    config.verify = args.verify;
+    config.telemetry_interval_ms = args.telemetry;
+    config.telemetry_capacity = size_t(args.telemetry_capacity);
+    config.latency_sample = size_t(args.latency_sample);
+    affinity::from_string(args.placement, config.placement);
+    config.cpu_list = affinity::parse_cpu_list(args.cpus);
+    backoff::from_string(args.backoff, config.backoff);
+    config.backoff_parameters = {unsigned(args.backoff_min_spins), unsigned(args.backoff_max_spins)};
+    config.payload_bytes = size_t(args.payload);
+    payload::from_string(args.payload_mode, config.payload_mode);
+    sizing::from_string(args.size_tracking, config.size_tracking);
+
+    Benchmark benchmark{std::move(config)};
+    benchmark.set_hardware(hardware ? &*hardware : nullptr);
+
+    if (queues::is_sequential(args.type) && args.n_threads != 1)
     {
-        // FIXED: This branch is now unreachable due to are_valid() check
-        // But keeping it for defensive programming
-        std::cerr << "Invalid queue type. Available: global_lock, fine_lock, lock_free" << std::endl;
-        return 1; // FIXED: Added return to prevent nullptr dereference
+        std::cerr << " n_threads>1 in sequential benchmark !!!" << std::endl;
+        std::abort();
     }
 
-    // FIXED: Additional safety check (defensive programming)
+    // The queues size their per thread free lists with omp_get_max_threads()
+    omp_set_num_threads(args.n_threads);
+
+    std::unique_ptr<BaseQueue> queue = queues::make_queue(args.type, args.contention, benchmark.get_config().backoff,
+                                                           benchmark.get_config().payload_bytes,
+                                                           benchmark.get_config().payload_mode,
+                                                           benchmark.get_config().backoff_parameters,
+                                                           benchmark.get_config().size_tracking);
     if (!queue)
     {
         std::cerr << "Failed to create queue" << std::endl;
         return 1;
     }
 
-    if (args.is_safe_run)
+    std::optional<trace::Recorder> trace_recorder;
+    std::optional<trace::RecordingQueue> recording;
+    if (!args.record_trace.empty())
     {
+        trace_recorder.emplace(size_t(args.n_threads), size_t(args.trace_capacity));
+        recording.emplace(*queue, *trace_recorder);
+    }
+    BaseQueue &target = recording ? static_cast<BaseQueue &>(*recording) : *queue;
 
-        benchmark.run_safe(*queue);
+    if (args.check_linearizability)
+    {
+        auto report = benchmark.run_history(target, args.history_capacity);
+        std::cerr << "Linearizability check over " << report.operations << " operations: "
+                  << (report.ok() ? "ok" : "VIOLATED") << "\n"
+                  << "  fresh values:     " << report.fresh << "\n"
+                  << "  duplicates:       " << report.duplicates << "\n"
+                  << "  lost values:      " << report.lost << "\n"
+                  << "  order violations: " << report.order_violations << "\n"
+                  << "  empty violations: " << report.empty_violations << std::endl;
+        benchmark.print_csv(args.type, args.print_header);
+        return report.ok() ? 0 : 2;
     }
-    else if (args.cache_checks) // Run cache line hits benchmark
+    else if (replay)
     {
-        auto *lock_free_queue = dynamic_cast<lock_free_aba::Queue *>(queue.get());
-        assert(lock_free_queue != nullptr && "cache_checks requires lock_free_aba::Queue");
-        std::cout << " Starting running cache checks" << std::endl;
-        auto total = benchmark.run_fast_cache_checks(*lock_free_queue);
-        std::cout << "Total cachec success: " << total.success << " \n Total cache failures: " << total.failures << std::endl;
-    } else if( args.max_time != 0)
+        benchmark.run_replay(target, *replay, args.replay_gaps);
+    }
+    else if( args.max_time != 0)
     {
-        benchmark.run_fast(*queue);
+        benchmark.run_fast(target);
     }
     else if(args.sets != 0){
-        benchmark.run_sets(*queue);
+        benchmark.run_sets(target);
     }
     else {
         std::cerr<< " For devs .Benchmark does not make sense. Please add guards in validation "<<std::endl;
     }
     benchmark.print_csv(args.type, args.print_header);
+    if (!args.output.empty())
+        benchmark.save_results(args.output, args.type);
+    if (!args.telemetry_output.empty())
+        benchmark.save_telemetry(args.telemetry_output, args.type);
+    if (trace_recorder)
+    {
+        if (!trace_recorder->save(args.record_trace))
+        {
+            std::cerr << "Could not write the trace to " << args.record_trace << std::endl;
+            return 1;
+        }
+        std::cerr << "Recorded " << trace_recorder->size() << " operations to " << args.record_trace
+                  << " (" << trace_recorder->dropped() << " dropped, see --trace_capacity)" << std::endl;
+    }
+
+    if (args.verify)
+    {
+        auto const &report = benchmark.get_verification();
+        std::cerr << "Sequence verification over " << report.pushed << " pushes: "
+                  << (report.ok() ? "ok" : "FAILED") << "\n"
+                  << "  lost:       " << report.lost << "\n"
+                  << "  duplicated: " << report.duplicated << "\n"
+                  << "  reordered:  " << report.reordered << "\n"
+                  << "  unknown:    " << report.unknown << std::endl;
+        return report.ok() ? 0 : 2;
+    }
     return 0;
 }
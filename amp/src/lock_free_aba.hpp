@@ -11,6 +11,10 @@ locks.
 #pragma once
 #include "base_queue.hpp"
 #include "generics.hpp"
+#include "backoff.hpp"
+#include "instrumentation.hpp"
+#include "payload.hpp"
+#include "sizing.hpp"
 #include <atomic>
 #include <cassert>
 #include <limits>
@@ -151,29 +155,30 @@ namespace lock_free_aba
     using value_t = generics::value_t;
     value_t empty_val = generics::empty_val;
 
-    struct alignas(64) CASCounter
+    // Align to cache line to avoid false sharing. Slot is the message of
+    // the payload policy (payload.hpp).
+    template <typename Slot>
+    struct alignas(64) BasicNode
     {
-        size_t success{};
-        size_t failures{};
-    };
-    // Align to cache line to avoid false sharing
-    struct alignas(64) Node
-    {
-        TaggedPointer<Node> next;
+        TaggedPointer<BasicNode> next;
         value_t value;
+        [[no_unique_address]] Slot payload;
 
-        Node() : next(nullptr, 0), value(empty_val) {}
+        BasicNode() : next(nullptr, 0), value(empty_val) {}
     };
+    using Node = BasicNode<payload::None::Slot>;
 
-    class FreeList
+    template <typename Node>
+    class BasicFreeList
     {
         TaggedPointer<Node> header;
         std::atomic<unsigned int> size;
+        size_t allocated = 0;
 
     public:
-        FreeList() : header(nullptr, 0), size(0) {}
+        BasicFreeList() : header(nullptr, 0), size(0) {}
 
-        ~FreeList()
+        ~BasicFreeList()
         {
             Node *walker = header.getPointer(std::memory_order_relaxed);
             while (walker)
@@ -185,7 +190,7 @@ namespace lock_free_aba
         }
 
         // Copy constructor (deep copy)
-        FreeList(const FreeList &other) : header(nullptr, 0), size(0)
+        BasicFreeList(const BasicFreeList &other) : header(nullptr, 0), size(0)
         {
             Node *otherWalker = other.header.getPointer(std::memory_order_acquire);
             if (!otherWalker)
@@ -216,7 +221,7 @@ namespace lock_free_aba
         }
 
         // Copy assignment
-        FreeList &operator=(const FreeList &other)
+        BasicFreeList &operator=(const BasicFreeList &other)
         {
             if (this == &other)
                 return *this;
@@ -265,7 +270,7 @@ namespace lock_free_aba
         }
 
         // Move constructor
-        FreeList(FreeList &&other) noexcept
+        BasicFreeList(BasicFreeList &&other) noexcept
         {
             Node *ptr;
             uint16_t ver;
@@ -278,7 +283,7 @@ namespace lock_free_aba
         }
 
         // Move assignment
-        FreeList &operator=(FreeList &&other) noexcept
+        BasicFreeList &operator=(BasicFreeList &&other) noexcept
         {
             if (this != &other)
             {
@@ -321,7 +326,8 @@ namespace lock_free_aba
             }
         }
 
-        Node *get(value_t val)
+        // Pops any free node, the caller overwrites the value
+        Node *get()
         {
             while (true)
             {
@@ -332,42 +338,12 @@ namespace lock_free_aba
                 if (!head)
                     return nullptr;
 
-                // Check if head matches
-                if (head->value == val)
-                {
-                    Node *next;
-                    uint16_t nextVer;
-                    head->next.get(&next, &nextVer, std::memory_order_acquire);
-
-                    if (header.compareAndSet(head, headVer, next, headVer + 1))
-                    {
-                        size.fetch_sub(1, std::memory_order_relaxed);
-                        return head;
-                    }
-                    continue;
-                }
-
-                // Search through list (not lock-free for interior nodes)
-                Node *walker = head;
-                Node *prev = nullptr;
-
-                while (walker)
+                Node *next = head->next.getPointer(std::memory_order_acquire);
+                if (header.compareAndSet(head, headVer, next, headVer + 1))
                 {
-                    Node *next = walker->next.getPointer(std::memory_order_acquire);
-
-                    if (walker->value == val && prev != nullptr)
-                    {
-                        // This part is tricky - we'd need a lock-free linked list deletion
-                        // For simplicity, just return nullptr if not at head
-                        // A full implementation would need DCAS or Harris's algorithm
-                        return nullptr;
-                    }
-
-                    prev = walker;
-                    walker = next;
+                    size.fetch_sub(1, std::memory_order_relaxed);
+                    return head;
                 }
-
-                return nullptr;
             }
         }
 
@@ -375,17 +351,40 @@ namespace lock_free_aba
         {
             return size.load(std::memory_order_relaxed);
         }
+
+        // Counts the nodes the owner had to allocate because the list was
+        // empty. Only the owning thread calls it.
+        Node *allocate()
+        {
+            ++allocated;
+            return new Node;
+        }
+
+        size_t getAllocated() const
+        {
+            return allocated;
+        }
     };
-    class Queue : public BaseQueue
+    using FreeList = BasicFreeList<Node>;
+    template <typename Instr = instrumentation::None, typename Backoff = backoff::None,
+              typename Payload = payload::None, typename Size = sizing::Shared>
+    class BasicQueue : public BaseQueue
     {
-        TaggedPointer<Node> header;
-        TaggedPointer<Node> tail;
+        using Node = BasicNode<typename Payload::Slot>;
+        using FreeList = BasicFreeList<Node>;
+
+        // Pops CAS the header, pushes the tail, keep them apart
+        alignas(64) TaggedPointer<Node> header;
+        alignas(64) TaggedPointer<Node> tail;
 
-        std::vector<FreeList> freelists;
-        std::atomic<int> size;
+        alignas(64) std::vector<FreeList> freelists;
+        Instr instr;
+        Payload messages;
+        Backoff manager;
+        Size tracker; // aligns its own counters (sizing.hpp)
 
     public:
-        Queue()
+        explicit BasicQueue(Backoff backoff_policy = Backoff{}) : manager(backoff_policy)
         {
             Node *h = new Node;
             h->next.store(nullptr, 0, std::memory_order_relaxed);
@@ -394,13 +393,11 @@ namespace lock_free_aba
             header.store(h, 0, std::memory_order_relaxed);
             tail.store(h, 0, std::memory_order_relaxed);
 
-            size.store(0, std::memory_order_relaxed);
-
             int n_threads = omp_get_max_threads();
             freelists.resize(n_threads);
         }
 
-        ~Queue()
+        ~BasicQueue()
         {
             Node *walker = header.getPointer(std::memory_order_relaxed);
             while (walker)
@@ -411,77 +408,21 @@ namespace lock_free_aba
             }
         }
 
-        bool pushb(value_t val, CASCounter &counter)
-        {
-            int tid = omp_get_thread_num();
-
-            // Try to get cached node with this value
-            Node *n = freelists[tid].get(val);
-            if (n == nullptr)
-            {
-                // Not in cache, allocate new
-                n = new Node;
-                n->value = val;
-            }
-            // If found in cache, value is already set!
-
-            n->next.store(nullptr, 0, std::memory_order_relaxed);
-
-            while (true)
-            {
-                Node *last;
-                uint16_t tailVer;
-                tail.get(&last, &tailVer, std::memory_order_acquire);
-
-                Node *next;
-                uint16_t nextVer;
-                last->next.get(&next, &nextVer, std::memory_order_acquire);
-
-                if (next == nullptr)
-                {
-                    if (last->next.compareAndSet(next, nextVer, n, nextVer + 1,
-                                                 std::memory_order_release,
-                                                 std::memory_order_acquire))
-                    {
-                        // Successfully linked new node
-                        tail.compareAndSet(last, tailVer, n, tailVer + 1,
-                                           std::memory_order_release,
-                                           std::memory_order_relaxed);
-                        size.fetch_add(1, std::memory_order_relaxed);
-                        counter.success++;
-                        return true;
-                    }
-                }
-                else
-                {
-                    // Tail is lagging, help advance it
-                    if (tail.compareAndSet(last, tailVer, next, tailVer + 1,
-                                           std::memory_order_release,
-                                           std::memory_order_relaxed))
-                    {
-                        counter.success++;
-                    };
-                }
-            }
-
-            counter.failures++;
-        }
         bool push(value_t val) override
         {
             int tid = omp_get_thread_num();
 
-            // Try to get cached node with this value
-            Node *n = freelists[tid].get(val);
+            // Reuse a node of this thread's free list if there is one
+            Node *n = freelists[tid].get();
+            instr.freelist(n != nullptr);
             if (n == nullptr)
-            {
-                // Not in cache, allocate new
-                n = new Node;
-                n->value = val;
-            }
-            // If found in cache, value is already set!
+                n = freelists[tid].allocate();
+            n->value = val;
+            messages.write(n->payload, val);
 
             n->next.store(nullptr, 0, std::memory_order_relaxed);
 
+            unsigned attempts = 0;
             while (true)
             {
                 Node *last;
@@ -494,24 +435,28 @@ namespace lock_free_aba
 
                 if (next == nullptr)
                 {
-                    if (last->next.compareAndSet(next, nextVer, n, nextVer + 1,
-                                                 std::memory_order_release,
-                                                 std::memory_order_acquire))
+                    bool linked = last->next.compareAndSet(next, nextVer, n, nextVer + 1,
+                                                           std::memory_order_release,
+                                                           std::memory_order_acquire);
+                    instr.cas(linked);
+                    if (linked)
                     {
                         // Successfully linked new node
-                        tail.compareAndSet(last, tailVer, n, tailVer + 1,
-                                           std::memory_order_release,
-                                           std::memory_order_relaxed);
-                        size.fetch_add(1, std::memory_order_relaxed);
+                        instr.cas(tail.compareAndSet(last, tailVer, n, tailVer + 1,
+                                                     std::memory_order_release,
+                                                     std::memory_order_relaxed));
+                        tracker.pushed();
                         return true;
                     }
+                    manager.failed(attempts);
                 }
                 else
                 {
                     // Tail is lagging, help advance it
-                    tail.compareAndSet(last, tailVer, next, tailVer + 1,
-                                       std::memory_order_release,
-                                       std::memory_order_relaxed);
+                    instr.help();
+                    instr.cas(tail.compareAndSet(last, tailVer, next, tailVer + 1,
+                                                 std::memory_order_release,
+                                                 std::memory_order_relaxed));
                 }
             }
         }
@@ -520,6 +465,7 @@ namespace lock_free_aba
         {
             int tid = omp_get_thread_num();
 
+            unsigned attempts = 0;
             while (true)
             {
                 Node *first;
@@ -548,9 +494,10 @@ namespace lock_free_aba
                         return empty_val;
                     }
                     // Tail is lagging, help advance it
-                    tail.compareAndSet(last, tailVer, next, tailVer + 1,
-                                       std::memory_order_release,
-                                       std::memory_order_relaxed);
+                    instr.help();
+                    instr.cas(tail.compareAndSet(last, tailVer, next, tailVer + 1,
+                                                 std::memory_order_release,
+                                                 std::memory_order_relaxed));
                 }
                 else
                 {
@@ -563,94 +510,63 @@ namespace lock_free_aba
 
                     // ✅ Read value before CAS (important!)
                     value_t val = next->value;
+                    auto taken = messages.take(next->payload);
 
-                    if (header.compareAndSet(first, headVer, next, headVer + 1,
-                                             std::memory_order_release,
-                                             std::memory_order_acquire))
+                    bool unlinked = header.compareAndSet(first, headVer, next, headVer + 1,
+                                                         std::memory_order_release,
+                                                         std::memory_order_acquire);
+                    instr.cas(unlinked);
+                    if (unlinked)
                     {
                         // Successfully dequeued
-                        size.fetch_sub(1, std::memory_order_relaxed);
+                        tracker.popped();
                         freelists[tid].push(first); // ✅ Recycle dummy node
+                        messages.consume(taken);
                         return val;
                     }
+                    manager.failed(attempts);
                 }
             }
         }
-        value_t popb(CASCounter &counter)
+        int get_size() override
         {
-            int tid = omp_get_thread_num();
+            return tracker.get();
+        }
 
+        // True if the queue was empty at the moment the head's next was read:
+        // the head did not move around that read and had no successor
+        bool empty() const
+        {
             while (true)
             {
-                Node *first;
-                uint16_t headVer;
-                header.get(&first, &headVer, std::memory_order_acquire);
-
-                Node *last;
-                uint16_t tailVer;
-                tail.get(&last, &tailVer, std::memory_order_acquire);
-
-                Node *next;
-                uint16_t nextVer;
-                first->next.get(&next, &nextVer, std::memory_order_acquire);
-
-                // ✅ Check if head changed (ABA protection)
-                Node *currentHead = header.getPointer(std::memory_order_acquire);
-                if (first != currentHead)
-                    continue;
-
-                if (first == last)
-                {
-                    // Queue is empty or tail is lagging
-                    if (next == nullptr)
-                    {
-                        // Queue is truly empty
-                        return empty_val;
-                    }
-                    // Tail is lagging, help advance it
-                    if (tail.compareAndSet(last, tailVer, next, tailVer + 1,
-                                           std::memory_order_release,
-                                           std::memory_order_relaxed))
-                    {
-                        counter.success++;
-                    }
-                }
-                else
-                {
-                    // Queue has items
-                    if (next == nullptr)
-                    {
-                        // Inconsistent state, retry
-                        continue;
-                    }
-
-                    // ✅ Read value before CAS (important!)
-                    value_t val = next->value;
-
-                    if (header.compareAndSet(first, headVer, next, headVer + 1,
-                                             std::memory_order_release,
-                                             std::memory_order_acquire))
-                    {
-                        // Successfully dequeued
-                        size.fetch_sub(1, std::memory_order_relaxed);
-                        freelists[tid].push(first); // ✅ Recycle dummy node
-                        counter.success++;
-                        return val;
-                    }
-                }
-                counter.failures++;
+                auto [first, headVer] = header.load(std::memory_order_acquire);
+                Node *next = first->next.getPointer(std::memory_order_acquire);
+                if (header.load(std::memory_order_acquire) == std::pair{first, headVer})
+                    return next == nullptr;
             }
         }
 
-        int get_size() override
+        std::optional<instrumentation::Contention> contention() const override { return instr.contention(); }
+        void reset_contention() override { instr.reset(); }
+
+        std::optional<memory::Allocation> allocation() const override
         {
-            return size.load(std::memory_order_relaxed);
+            memory::Allocation to_rtn{sizeof(Node), 1, {}, // the dummy node
+                                      messages.buffer_bytes(), messages.buffers_allocated()};
+            for (auto const &f : freelists)
+            {
+                to_rtn.nodes_allocated += f.getAllocated();
+                to_rtn.free_nodes.push_back(f.getSize());
+            }
+            return to_rtn;
         }
 
-        Queue(const Queue &) = delete;
-        Queue(Queue &&) = delete;
-        Queue &operator=(const Queue &) = delete;
-        Queue &operator=(Queue &&) = delete;
+        BasicQueue(const BasicQueue &) = delete;
+        BasicQueue(BasicQueue &&) = delete;
+        BasicQueue &operator=(const BasicQueue &) = delete;
+        BasicQueue &operator=(BasicQueue &&) = delete;
     };
 
+    using Queue = BasicQueue<>;
+
 } // namespace lock_free_aba 
\ No newline at end of file
@@ -5,35 +5,45 @@
 #include <vector>
 #include <mutex>
 #include "sequential.hpp"
+#include "heap.hpp"
 #include "generics.hpp"
 #include "base_queue.hpp"
+#include "backoff.hpp"
+#include "instrumentation.hpp"
+#include "payload.hpp"
 
 
 namespace global_lock
 {
     using value_t = generics::value_t;
 
-class Queue: public BaseQueue
+// Wraps a sequential queue (Inner) in one lock. The free list hits and
+// misses are counted by the wrapped queue.
+template <typename Inner, typename Instr, typename Backoff>
+class Locked: public BaseQueue
 {
-    seq::Queue q;
+    Inner q;
     omp_lock_t global_lock;
+    Instr instr;
+    Backoff manager;
     // std::mutex m;
 
   public:
-    Queue(){
+    explicit Locked(Backoff backoff_policy = Backoff{}) : manager(backoff_policy)
+    {
         omp_init_lock(&global_lock);
     };
-    ~Queue(){
+    ~Locked(){
         omp_destroy_lock(&global_lock);
     }
-    Queue(Queue const&) = delete;
-    Queue& operator=(Queue const&) = delete;
-    Queue(Queue &&) = delete;
-    Queue& operator=(Queue &&) = delete;
+    Locked(Locked const&) = delete;
+    Locked& operator=(Locked const&) = delete;
+    Locked(Locked &&) = delete;
+    Locked& operator=(Locked &&) = delete;
 
     bool push(value_t v) override
     {
-        omp_set_lock(&global_lock);
+        instr.acquire(global_lock, manager);
         q.push(v);
         omp_unset_lock(&global_lock);
         return true;
@@ -42,7 +52,7 @@ class Queue: public BaseQueue
     value_t pop() override
     {
         value_t to_rtn;
-        omp_set_lock(&global_lock);
+        instr.acquire(global_lock, manager);
         to_rtn = q.pop();
         omp_unset_lock(&global_lock);
         return to_rtn;
@@ -55,5 +65,33 @@ class Queue: public BaseQueue
         omp_unset_lock(&global_lock);
         return size;
     }
+
+    std::optional<instrumentation::Contention> contention() const override
+    {
+        auto to_rtn = instr.contention();
+        if (to_rtn)
+            *to_rtn += *q.contention();
+        return to_rtn;
+    }
+
+    void reset_contention() override
+    {
+        instr.reset();
+        q.reset_contention();
+    }
+
+    std::optional<memory::Allocation> allocation() const override { return q.allocation(); }
 };
+
+// FIFO queue
+template <typename Instr = instrumentation::None, typename Backoff = backoff::None,
+          typename Payload = payload::None>
+using BasicQueue = Locked<seq::BasicQueue<Instr, backoff::None, Payload>, Instr, Backoff>;
+
+// Priority queue, smallest value first (heap.hpp)
+template <typename Instr = instrumentation::None, typename Backoff = backoff::None,
+          typename Payload = payload::None>
+using BasicHeap = Locked<heap::BasicQueue<Instr, backoff::None, Payload>, Instr, Backoff>;
+
+using Queue = BasicQueue<>;
 }; // namespace global_lock
\ No newline at end of file
@@ -0,0 +1,221 @@
+/*
+Lock microbenchmark over the locks of locks.hpp and a list of thread counts.
+
+Every point runs two timed phases of max_time_in_s each, with all threads
+acquiring and releasing the same lock around a tiny critical section:
+
+  throughput : acquisitions per second, and Jain's fairness index
+               (sum x)^2 / (n sum x^2) over the per thread acquisitions,
+               1 is perfectly fair, 1/n means one thread got everything
+  handoff    : the releasing thread stores a timestamp inside the critical
+               section; a different thread that acquires next reports the
+               time since then. Timestamps cost a clock read per
+               acquisition, so they stay out of the throughput phase.
+
+The critical section also increments a plain counter; it has to end up
+equal to the number of acquisitions, otherwise the lock is broken.
+*/
+
+#pragma once
+#include "affinity.hpp"
+#include "host_info.hpp"
+#include "json.hpp"
+#include "locks.hpp"
+
+#include <omp.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace lockbench
+{
+    struct Result
+    {
+        std::string lock;
+        int n_threads{};
+        double acquisitions_per_s{};
+        double fairness{}; // Jain's index
+        double handoff_ns{};
+        uint64_t handoffs{};
+        bool mutual_exclusion{true};
+    };
+
+    inline double jain(std::vector<uint64_t> const &x)
+    {
+        double sum = 0, sq_sum = 0;
+        for (uint64_t v : x)
+        {
+            sum += double(v);
+            sq_sum += double(v) * double(v);
+        }
+        return sq_sum == 0 ? 1.0 : sum * sum / (double(x.size()) * sq_sum);
+    }
+
+    inline int64_t now_ns()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch())
+            .count();
+    }
+
+    template <typename L, bool timestamps>
+    void phase(L &lock, int n_threads, double max_time_in_s, std::vector<int> const &cpus,
+               std::vector<uint64_t> &acquisitions, uint64_t &counter,
+               uint64_t &handoffs, int64_t &handoff_sum, double &elapsed)
+    {
+        // Protected by the lock
+        int last_owner = -1;
+        int64_t released_at = 0;
+        acquisitions.assign(n_threads, 0);
+
+#pragma omp parallel num_threads(n_threads)
+        {
+            int tid = omp_get_thread_num();
+            if (!cpus.empty())
+                affinity::pin_current_thread(cpus[size_t(tid) % cpus.size()]);
+            uint64_t mine = 0;
+            uint64_t my_handoffs = 0;
+            int64_t my_handoff_sum = 0;
+#pragma omp barrier
+            double t_start = omp_get_wtime();
+            do
+            {
+                for (int i = 0; i < 64; ++i)
+                {
+                    lock.lock(tid);
+                    counter++;
+                    if constexpr (timestamps)
+                    {
+                        int64_t t = now_ns();
+                        if (last_owner != -1 && last_owner != tid)
+                        {
+                            my_handoffs++;
+                            my_handoff_sum += t - released_at;
+                        }
+                        last_owner = tid;
+                        released_at = now_ns();
+                    }
+                    lock.unlock(tid);
+                }
+                mine += 64;
+            } while (omp_get_wtime() - t_start < max_time_in_s);
+            double t_end = omp_get_wtime();
+
+            acquisitions[tid] = mine;
+#pragma omp critical
+            {
+                handoffs += my_handoffs;
+                handoff_sum += my_handoff_sum;
+                elapsed = std::max(elapsed, t_end - t_start);
+            }
+        }
+    }
+
+    template <typename L>
+    Result run(int n_threads, double max_time_in_s, std::vector<int> const &cpus)
+    {
+        Result to_rtn{};
+        to_rtn.lock = L::name;
+        to_rtn.n_threads = n_threads;
+
+        std::vector<uint64_t> acquisitions;
+        uint64_t handoffs = 0;
+        int64_t handoff_sum = 0;
+        {
+            L lock(n_threads);
+            uint64_t counter = 0;
+            double elapsed = 0;
+            phase<L, false>(lock, n_threads, max_time_in_s, cpus, acquisitions, counter,
+                            handoffs, handoff_sum, elapsed);
+            uint64_t total = 0;
+            for (uint64_t a : acquisitions)
+                total += a;
+            to_rtn.acquisitions_per_s = double(total) / elapsed;
+            to_rtn.fairness = jain(acquisitions);
+            to_rtn.mutual_exclusion = counter == total;
+        }
+        {
+            L lock(n_threads);
+            uint64_t counter = 0;
+            double elapsed = 0;
+            phase<L, true>(lock, n_threads, max_time_in_s, cpus, acquisitions, counter,
+                           handoffs, handoff_sum, elapsed);
+            uint64_t total = 0;
+            for (uint64_t a : acquisitions)
+                total += a;
+            to_rtn.mutual_exclusion = to_rtn.mutual_exclusion && counter == total;
+            to_rtn.handoffs = handoffs;
+            to_rtn.handoff_ns = handoffs ? double(handoff_sum) / double(handoffs) : -1.0;
+        }
+        return to_rtn;
+    }
+
+    using Runner = std::function<Result(int n_threads, double max_time_in_s, std::vector<int> const &cpus)>;
+
+    template <typename L>
+    std::pair<std::string, std::pair<int, Runner>> entry()
+    {
+        return {L::name, {L::max_threads, run<L>}};
+    }
+
+    // name -> (max threads, runner)
+    inline std::map<std::string, std::pair<int, Runner>> const &registry()
+    {
+        static const std::map<std::string, std::pair<int, Runner>> runners{
+            entry<locks::Peterson>(), entry<locks::Filter>(), entry<locks::Bakery>(),
+            entry<locks::TAS>(), entry<locks::TTAS>(), entry<locks::Ticket>(),
+            entry<locks::MCS>(), entry<locks::StdMutex>(), entry<locks::OmpLock>()};
+        return runners;
+    }
+
+    inline void print_csv(Result const &r, bool header)
+    {
+        if (header)
+            std::cout << "lock,n_threads,acquisitions_per_s,fairness,handoff_ns,handoffs,mutual_exclusion\n";
+        std::cout << r.lock << "," << r.n_threads << "," << r.acquisitions_per_s << ","
+                  << r.fairness << ",";
+        if (r.handoff_ns < 0)
+            std::cout << "NA";
+        else
+            std::cout << r.handoff_ns;
+        std::cout << "," << r.handoffs << "," << (r.mutual_exclusion ? "ok" : "VIOLATED") << std::endl;
+    }
+
+    // Appends one JSON line per point, like Benchmark::save_results
+    inline void save(std::string const &output, Result const &r, double max_time_in_s)
+    {
+        std::ofstream out(output, std::ios::app);
+        if (!out)
+        {
+            std::cerr << "Could not open " << output << " for writing" << std::endl;
+            return;
+        }
+        out.precision(10);
+        host_info::HostInfo host = host_info::query();
+        out << "{\"name\":" << json::quote("lock:" + r.lock)
+            << ",\"timestamp\":" << json::quote(host_info::timestamp())
+            << ",\"host\":{\"hostname\":" << json::quote(host.hostname)
+            << ",\"cpu_model\":" << json::quote(host.cpu_model)
+            << ",\"logical_cpus\":" << host.logical_cpus << "}"
+            << ",\"config\":{\"num_threads\":" << r.n_threads
+            << ",\"max_time_in_s\":" << max_time_in_s << "}"
+            << ",\"summary\":{\"acquisitions_per_s\":" << r.acquisitions_per_s
+            << ",\"fairness\":" << r.fairness
+            << ",\"handoff_ns\":";
+        if (r.handoff_ns < 0)
+            out << "null";
+        else
+            out << r.handoff_ns;
+        out << ",\"handoffs\":" << r.handoffs
+            << ",\"mutual_exclusion\":" << (r.mutual_exclusion ? "true" : "false") << "}}"
+            << std::endl;
+    }
+}; // namespace lockbench
@@ -0,0 +1,282 @@
+/*
+Mutual exclusion locks behind one interface, for the lock benchmark
+(lockbench.hpp):
+
+  L lock(n_threads);  lock.lock(tid);  ...  lock.unlock(tid);
+
+tid is the caller's index in [0, n_threads). The classic algorithms
+(Peterson, filter, bakery) rely on a store followed by a load of another
+location not being reordered, so they use sequentially consistent atomics;
+the hardware based spin locks only need acquire/release.
+*/
+
+#pragma once
+#include "spin.hpp"
+
+#include <omp.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+
+namespace locks
+{
+    template <typename T>
+    struct alignas(64) Padded
+    {
+        T value{};
+    };
+
+    // Two threads only
+    class Peterson
+    {
+        Padded<std::atomic<bool>> interested[2];
+        Padded<std::atomic<int>> victim;
+
+    public:
+        static constexpr char const *name = "peterson";
+        static constexpr int max_threads = 2;
+
+        explicit Peterson(int) {}
+
+        void lock(int tid)
+        {
+            int other = 1 - tid;
+            interested[tid].value.store(true);
+            victim.value.store(tid);
+            spin::until([&]
+                        { return !interested[other].value.load() || victim.value.load() != tid; });
+        }
+
+        void unlock(int tid) { interested[tid].value.store(false, std::memory_order_release); }
+    };
+
+    // Peterson generalized to n threads through n - 1 levels
+    class Filter
+    {
+        int n;
+        std::unique_ptr<Padded<std::atomic<int>>[]> level;
+        std::unique_ptr<Padded<std::atomic<int>>[]> victim;
+
+    public:
+        static constexpr char const *name = "filter";
+        static constexpr int max_threads = 1 << 16;
+
+        explicit Filter(int n_threads)
+            : n(n_threads), level(new Padded<std::atomic<int>>[n_threads]),
+              victim(new Padded<std::atomic<int>>[n_threads]) {}
+
+        void lock(int tid)
+        {
+            for (int l = 1; l < n; ++l)
+            {
+                level[tid].value.store(l);
+                victim[l].value.store(tid);
+                spin::until([&]
+                            {
+                    if (victim[l].value.load() != tid)
+                        return true;
+                    for (int k = 0; k < n; ++k)
+                        if (k != tid && level[k].value.load() >= l)
+                            return false;
+                    return true; });
+            }
+        }
+
+        void unlock(int tid) { level[tid].value.store(0, std::memory_order_release); }
+    };
+
+    // Lamport's bakery, first come first served
+    class Bakery
+    {
+        int n;
+        std::unique_ptr<Padded<std::atomic<bool>>[]> choosing;
+        std::unique_ptr<Padded<std::atomic<uint64_t>>[]> label;
+
+    public:
+        static constexpr char const *name = "bakery";
+        static constexpr int max_threads = 1 << 16;
+
+        explicit Bakery(int n_threads)
+            : n(n_threads), choosing(new Padded<std::atomic<bool>>[n_threads]),
+              label(new Padded<std::atomic<uint64_t>>[n_threads]) {}
+
+        void lock(int tid)
+        {
+            choosing[tid].value.store(true);
+            uint64_t max_label = 0;
+            for (int k = 0; k < n; ++k)
+                max_label = std::max(max_label, label[k].value.load());
+            label[tid].value.store(max_label + 1);
+            choosing[tid].value.store(false);
+
+            uint64_t mine = max_label + 1;
+            for (int k = 0; k < n; ++k)
+            {
+                if (k == tid)
+                    continue;
+                spin::until([&]
+                            { return !choosing[k].value.load(); });
+                spin::until([&]
+                            {
+                    uint64_t other = label[k].value.load();
+                    return other == 0 || other > mine || (other == mine && k > tid); });
+            }
+        }
+
+        void unlock(int tid) { label[tid].value.store(0, std::memory_order_release); }
+    };
+
+    class TAS
+    {
+        Padded<std::atomic<bool>> locked;
+
+    public:
+        static constexpr char const *name = "tas";
+        static constexpr int max_threads = 1 << 16;
+
+        explicit TAS(int) {}
+
+        void lock(int)
+        {
+            spin::until([&]
+                        { return !locked.value.exchange(true, std::memory_order_acquire); });
+        }
+
+        void unlock(int) { locked.value.store(false, std::memory_order_release); }
+    };
+
+    // Spins on a plain load and only then tries the exchange
+    class TTAS
+    {
+        Padded<std::atomic<bool>> locked;
+
+    public:
+        static constexpr char const *name = "ttas";
+        static constexpr int max_threads = 1 << 16;
+
+        explicit TTAS(int) {}
+
+        void lock(int)
+        {
+            while (true)
+            {
+                spin::until([&]
+                            { return !locked.value.load(std::memory_order_relaxed); });
+                if (!locked.value.exchange(true, std::memory_order_acquire))
+                    return;
+            }
+        }
+
+        void unlock(int) { locked.value.store(false, std::memory_order_release); }
+    };
+
+    class Ticket
+    {
+        Padded<std::atomic<uint64_t>> next;
+        Padded<std::atomic<uint64_t>> serving;
+
+    public:
+        static constexpr char const *name = "ticket";
+        static constexpr int max_threads = 1 << 16;
+
+        explicit Ticket(int) {}
+
+        void lock(int)
+        {
+            uint64_t mine = next.value.fetch_add(1, std::memory_order_relaxed);
+            spin::until([&]
+                        { return serving.value.load(std::memory_order_acquire) == mine; });
+        }
+
+        void unlock(int)
+        {
+            serving.value.store(serving.value.load(std::memory_order_relaxed) + 1,
+                                std::memory_order_release);
+        }
+    };
+
+    // Queue lock, every thread spins on its own node
+    class MCS
+    {
+        struct alignas(64) Node
+        {
+            std::atomic<Node *> next{nullptr};
+            std::atomic<bool> locked{false};
+        };
+
+        Padded<std::atomic<Node *>> tail;
+        std::unique_ptr<Node[]> nodes; // one per thread
+
+    public:
+        static constexpr char const *name = "mcs";
+        static constexpr int max_threads = 1 << 16;
+
+        explicit MCS(int n_threads) : nodes(new Node[n_threads]) {}
+
+        void lock(int tid)
+        {
+            Node *me = &nodes[tid];
+            me->next.store(nullptr, std::memory_order_relaxed);
+            me->locked.store(true, std::memory_order_relaxed);
+
+            Node *pred = tail.value.exchange(me, std::memory_order_acq_rel);
+            if (pred == nullptr)
+                return;
+            pred->next.store(me, std::memory_order_release);
+            spin::until([&]
+                        { return !me->locked.load(std::memory_order_acquire); });
+        }
+
+        void unlock(int tid)
+        {
+            Node *me = &nodes[tid];
+            Node *succ = me->next.load(std::memory_order_acquire);
+            if (succ == nullptr)
+            {
+                Node *expected = me;
+                if (tail.value.compare_exchange_strong(expected, nullptr, std::memory_order_acq_rel))
+                    return;
+                // A successor is between its exchange and linking itself
+                spin::until([&]
+                            { return (succ = me->next.load(std::memory_order_acquire)) != nullptr; });
+            }
+            succ->locked.store(false, std::memory_order_release);
+        }
+    };
+
+    class StdMutex
+    {
+        std::mutex m;
+
+    public:
+        static constexpr char const *name = "std_mutex";
+        static constexpr int max_threads = 1 << 16;
+
+        explicit StdMutex(int) {}
+
+        void lock(int) { m.lock(); }
+        void unlock(int) { m.unlock(); }
+    };
+
+    // What global_lock and fine_lock use today
+    class OmpLock
+    {
+        omp_lock_t l;
+
+    public:
+        static constexpr char const *name = "omp_lock";
+        static constexpr int max_threads = 1 << 16;
+
+        explicit OmpLock(int) { omp_init_lock(&l); }
+        ~OmpLock() { omp_destroy_lock(&l); }
+
+        OmpLock(OmpLock const &) = delete;
+        OmpLock &operator=(OmpLock const &) = delete;
+
+        void lock(int) { omp_set_lock(&l); }
+        void unlock(int) { omp_unset_lock(&l); }
+    };
+}; // namespace locks
@@ -0,0 +1,85 @@
+/*
+Memory footprint of a run.
+
+  Allocation : nodes a queue has allocated so far (they are never returned
+               to the system before the queue dies, popped nodes go to the
+               free list of the popping thread) and how many of them sit in
+               each thread's free list right now
+  Rss        : resident set size of the process from /proc/self/status,
+               VmRSS (current) and VmHWM (peak). The peak is reset with
+               /proc/self/clear_refs at the start of a run, so it covers the
+               run only, where the kernel allows it (Linux >= 4.0).
+
+The RSS is the one of the whole process, the input batches and the per
+thread counters are part of it.
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace memory
+{
+    struct Allocation
+    {
+        size_t node_bytes{};             // sizeof one node, the cost of a queued element
+        size_t nodes_allocated{};        // since construction, dummy nodes included
+        std::vector<size_t> free_nodes;  // per thread free list
+        size_t buffer_bytes{};           // of a pooled payload, 0 if none (payload.hpp)
+        size_t buffers_allocated{};
+
+        // Node plus pooled buffer
+        size_t bytes_per_element() const { return node_bytes + buffer_bytes; }
+
+        size_t free_total() const
+        {
+            size_t to_rtn = 0;
+            for (size_t n : free_nodes)
+                to_rtn += n;
+            return to_rtn;
+        }
+
+        size_t free_max() const
+        {
+            return free_nodes.empty() ? 0 : *std::max_element(free_nodes.begin(), free_nodes.end());
+        }
+    };
+
+    struct Rss
+    {
+        long current_kb{-1}; // -1 if /proc is not readable
+        long peak_kb{-1};
+    };
+
+    inline Rss read_rss()
+    {
+        Rss to_rtn{};
+        std::ifstream in("/proc/self/status");
+        std::string line;
+        while (std::getline(in, line))
+        {
+            std::istringstream fields(line);
+            std::string key;
+            long kb;
+            if (!(fields >> key >> kb))
+                continue;
+            if (key == "VmRSS:")
+                to_rtn.current_kb = kb;
+            else if (key == "VmHWM:")
+                to_rtn.peak_kb = kb;
+        }
+        return to_rtn;
+    }
+
+    // Sets the peak to the current RSS, false if the kernel refused
+    inline bool reset_peak_rss()
+    {
+        std::ofstream out("/proc/self/clear_refs");
+        return static_cast<bool>(out << "5" << std::flush);
+    }
+}; // namespace memory
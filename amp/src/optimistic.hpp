@@ -0,0 +1,276 @@
+/*
+Optimistic queue (Ladan-Mozes and Shavit, "An optimistic approach to
+lock-free FIFO queues").
+
+A push in lock_free_aba needs two successful CASes, one on last->next and
+one on the tail. Here the list is doubly linked and built from the tail
+side: a push sets its node's next to the current tail and swings the tail
+with a single CAS, then stores the back pointer (prev) of the old tail with
+a plain write. Pops walk the prev pointers from the head.
+
+A prev pointer can be missing or stale because the producer has not
+written it yet, or because it was written to a node that got recycled in
+the meantime. Tags tell: the node that came in with tail tag t has next
+tag t, and the prev of the head must carry the head tag. On a mismatch the
+pop walks the next pointers from the tail to the head and rewrites the prev
+pointers (fix_list), which the paper finds to be rare.
+
+The head node holds the next value to pop, not a dummy. To take the last
+element, a pop first pushes a dummy node behind it. Dummy nodes hold
+dummy_val and are skipped by pops. Popped nodes go to the popper's free
+list (the one of lock_free_aba) and carry the payload message like in the
+other queues.
+*/
+
+#pragma once
+#include "backoff.hpp"
+#include "base_queue.hpp"
+#include "generics.hpp"
+#include "instrumentation.hpp"
+#include "lock_free_aba.hpp"
+#include "payload.hpp"
+#include "sizing.hpp"
+
+#include <omp.h>
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+namespace optimistic
+{
+    using value_t = generics::value_t;
+    inline constexpr value_t empty_val = generics::empty_val;
+    inline constexpr value_t dummy_val = generics::empty_val; // never pushed
+
+    template <typename Slot>
+    struct alignas(64) BasicNode
+    {
+        TaggedPointer<BasicNode> next; // towards the head, set before the node is linked
+        TaggedPointer<BasicNode> prev; // towards the tail, set lazily
+        value_t value;
+        [[no_unique_address]] Slot payload;
+
+        BasicNode() : next(nullptr, 0), prev(nullptr, 0), value(dummy_val) {}
+    };
+
+    // Unpacked view of a TaggedPointer
+    template <typename Node>
+    struct Ref
+    {
+        Node *ptr{};
+        uint16_t tag{};
+
+        bool operator==(Ref const &) const = default;
+    };
+
+    template <typename Node>
+    Ref<Node> load(TaggedPointer<Node> const &p)
+    {
+        auto [ptr, tag] = p.load(std::memory_order_acquire);
+        return {ptr, tag};
+    }
+
+    template <typename Node>
+    void store(TaggedPointer<Node> &p, Ref<Node> const &r,
+               std::memory_order order = std::memory_order_release)
+    {
+        p.store(r.ptr, r.tag, order);
+    }
+
+    template <typename Node>
+    bool cas(TaggedPointer<Node> &p, Ref<Node> const &expected, Ref<Node> const &desired)
+    {
+        return p.compareAndSet(expected.ptr, expected.tag, desired.ptr, desired.tag);
+    }
+
+    template <typename Instr = instrumentation::None, typename Backoff = backoff::None,
+              typename Payload = payload::None, typename Size = sizing::Shared>
+    class BasicQueue : public BaseQueue
+    {
+        using Node = BasicNode<typename Payload::Slot>;
+        using FreeList = lock_free_aba::BasicFreeList<Node>;
+        using Link = Ref<Node>;
+
+        alignas(64) TaggedPointer<Node> header;
+        alignas(64) TaggedPointer<Node> tail;
+
+        alignas(64) std::vector<FreeList> freelists;
+        Instr instr;
+        Payload messages;
+        Backoff manager;
+        Size tracker;
+
+        Node *new_node(int tid)
+        {
+            Node *n = freelists[tid].get();
+            instr.freelist(n != nullptr);
+            if (n == nullptr)
+                n = freelists[tid].allocate();
+            return n;
+        }
+
+        // Rewrites the prev pointers from last to first along the next pointers
+        void fix_list(Link last, Link first)
+        {
+            instr.help();
+            Link current = last;
+            while (load(header) == first && !(current == first))
+            {
+                Link next = load(current.ptr->next);
+                if (next.tag != current.tag || next.ptr == nullptr)
+                    return; // current was recycled
+                Link back{current.ptr, uint16_t(current.tag - 1)};
+                if (!(load(next.ptr->prev) == back))
+                    store(next.ptr->prev, back);
+                current = {next.ptr, uint16_t(current.tag - 1)};
+            }
+        }
+
+    public:
+        explicit BasicQueue(Backoff backoff_policy = Backoff{}) : manager(backoff_policy)
+        {
+            Node *dummy = new Node;
+
+            header.store(dummy, 0, std::memory_order_relaxed);
+            tail.store(dummy, 0, std::memory_order_relaxed);
+
+            int n_threads = omp_get_max_threads();
+            freelists.resize(n_threads);
+        }
+
+        // The next pointers lead from the tail to the head and on into nodes
+        // that are already in some free list
+        ~BasicQueue()
+        {
+            Node *first = header.getPointer(std::memory_order_relaxed);
+            Node *walker = tail.getPointer(std::memory_order_relaxed);
+            while (true)
+            {
+                Node *current = walker;
+                walker = walker->next.getPointer(std::memory_order_relaxed);
+                delete current;
+                if (current == first)
+                    break;
+            }
+        }
+
+        BasicQueue(const BasicQueue &) = delete;
+        BasicQueue(BasicQueue &&) = delete;
+        BasicQueue &operator=(const BasicQueue &) = delete;
+        BasicQueue &operator=(BasicQueue &&) = delete;
+
+        bool push(value_t val) override
+        {
+            int tid = omp_get_thread_num();
+
+            Node *n = new_node(tid);
+            n->value = val;
+            messages.write(n->payload, val);
+
+            unsigned attempts = 0;
+            while (true)
+            {
+                Link last = load(tail);
+                store(n->next, {last.ptr, uint16_t(last.tag + 1)}, std::memory_order_relaxed);
+                bool linked = cas(tail, last, {n, uint16_t(last.tag + 1)});
+                instr.cas(linked);
+                if (linked)
+                {
+                    store(last.ptr->prev, {n, last.tag});
+                    tracker.pushed();
+                    return true;
+                }
+                manager.failed(attempts);
+            }
+        }
+
+        value_t pop() override
+        {
+            int tid = omp_get_thread_num();
+
+            unsigned attempts = 0;
+            while (true)
+            {
+                Link first = load(header);
+                Link last = load(tail);
+                Link first_prev = load(first.ptr->prev);
+                value_t val = first.ptr->value;
+                auto taken = messages.take(first.ptr->payload);
+                if (!(load(header) == first))
+                    continue;
+
+                if (val == dummy_val)
+                {
+                    if (first.ptr == last.ptr)
+                        return empty_val;
+                    if (first_prev.tag != first.tag)
+                    {
+                        fix_list(last, first);
+                        continue;
+                    }
+                    // Skip the dummy
+                    bool moved = cas(header, first, {first_prev.ptr, uint16_t(first.tag + 1)});
+                    instr.cas(moved);
+                    if (moved)
+                        freelists[tid].push(first.ptr);
+                    continue;
+                }
+
+                if (first == last)
+                {
+                    // Last element, put a dummy behind it so the head can move
+                    Node *dummy = new_node(tid);
+                    dummy->value = dummy_val;
+                    store(dummy->next, {last.ptr, uint16_t(last.tag + 1)}, std::memory_order_relaxed);
+                    bool linked = cas(tail, last, {dummy, uint16_t(last.tag + 1)});
+                    instr.cas(linked);
+                    if (linked)
+                        store(first.ptr->prev, {dummy, last.tag});
+                    else
+                        freelists[tid].push(dummy);
+                    continue;
+                }
+
+                if (first_prev.tag != first.tag)
+                {
+                    fix_list(last, first);
+                    continue;
+                }
+
+                bool moved = cas(header, first, {first_prev.ptr, uint16_t(first.tag + 1)});
+                instr.cas(moved);
+                if (moved)
+                {
+                    freelists[tid].push(first.ptr);
+                    tracker.popped();
+                    messages.consume(taken);
+                    return val;
+                }
+                manager.failed(attempts);
+            }
+        }
+
+        int get_size() override
+        {
+            return tracker.get();
+        }
+
+        std::optional<instrumentation::Contention> contention() const override { return instr.contention(); }
+        void reset_contention() override { instr.reset(); }
+
+        std::optional<memory::Allocation> allocation() const override
+        {
+            memory::Allocation to_rtn{sizeof(Node), 1, {}, // the first dummy node
+                                      messages.buffer_bytes(), messages.buffers_allocated()};
+            for (auto const &f : freelists)
+            {
+                to_rtn.nodes_allocated += f.getAllocated();
+                to_rtn.free_nodes.push_back(f.getSize());
+            }
+            return to_rtn;
+        }
+    };
+
+    using Queue = BasicQueue<>;
+}; // namespace optimistic
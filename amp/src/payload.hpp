@@ -0,0 +1,213 @@
+/*
+Payload policies: the message a queue element carries next to its value_t,
+the third template parameter of the queues after instrumentation and
+backoff.
+
+  Slot           : member of the node, empty (and without space, see
+                   [[no_unique_address]]) for None
+  write(slot, v) : the producer fills the message before the node is linked
+  take(slot)     : the consumer copies what it needs out of the node. The
+                   lock free queue does this before its CAS, like it reads
+                   the value, a failed CAS throws the copy away.
+  consume(taken) : once the element is dequeued the consumer reads the
+                   whole message
+
+  None      : only the value
+  Inline<N> : N bytes inside the node, copied in by push and out by pop
+  Pooled<N> : the node holds a pointer to an N byte buffer taken from the
+              producer's pool, the consumer reads it and puts it into its
+              own pool. Per thread pools are sized with omp_get_max_threads()
+              like the free lists.
+
+A message is N / 8 words that all hold the value. consume() folds them into
+a per thread sink so that the reads are not optimized away.
+*/
+
+#pragma once
+#include "generics.hpp"
+
+#include <omp.h>
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <map>
+#include <new>
+#include <string>
+#include <vector>
+
+namespace payload
+{
+    using value_t = generics::value_t;
+
+    enum class Mode
+    {
+        Inline,
+        Pooled
+    };
+
+    inline std::string to_string(Mode mode)
+    {
+        return mode == Mode::Pooled ? "pooled" : "inline";
+    }
+
+    inline bool from_string(std::string const &name, Mode &mode)
+    {
+        static const std::map<std::string, Mode> names{
+            {"inline", Mode::Inline},
+            {"pooled", Mode::Pooled}};
+
+        auto it = names.find(name);
+        if (it == names.end())
+            return false;
+        mode = it->second;
+        return true;
+    }
+
+    // Message sizes the queues are instantiated for, besides 0 (None)
+    inline constexpr std::array<size_t, 3> sizes{64, 256, 1024};
+
+    inline bool supported(size_t bytes)
+    {
+        return bytes == 0 || std::find(sizes.begin(), sizes.end(), bytes) != sizes.end();
+    }
+
+    inline thread_local uint64_t sink = 0;
+
+    inline void fill(uint64_t *words, size_t n, value_t v)
+    {
+        std::fill_n(words, n, uint64_t(v));
+    }
+
+    inline void drain(uint64_t const *words, size_t n)
+    {
+        uint64_t x = 0;
+        for (size_t i = 0; i < n; ++i)
+            x ^= words[i];
+        sink += x;
+    }
+
+    struct None
+    {
+        struct Slot
+        {
+        };
+        struct Taken
+        {
+        };
+
+        void write(Slot &, value_t) {}
+        Taken take(Slot const &) const { return {}; }
+        void consume(Taken const &) {}
+
+        size_t buffer_bytes() const { return 0; }
+        size_t buffers_allocated() const { return 0; }
+    };
+
+    template <size_t N>
+    struct Inline
+    {
+        static_assert(N % sizeof(uint64_t) == 0, "whole words only");
+        static constexpr size_t n_words = N / sizeof(uint64_t);
+
+        struct Slot
+        {
+            std::array<uint64_t, n_words> words;
+        };
+        using Taken = Slot;
+
+        void write(Slot &slot, value_t v) { fill(slot.words.data(), n_words, v); }
+        Taken take(Slot const &slot) const { return slot; }
+        void consume(Taken const &taken) { drain(taken.words.data(), n_words); }
+
+        size_t buffer_bytes() const { return 0; }
+        size_t buffers_allocated() const { return 0; }
+    };
+
+    template <size_t N>
+    class Pooled
+    {
+        static_assert(N % sizeof(uint64_t) == 0, "whole words only");
+        static constexpr size_t n_words = N / sizeof(uint64_t);
+        static constexpr std::align_val_t alignment{64};
+
+        // Only touched by its thread
+        struct alignas(64) Pool
+        {
+            std::vector<uint64_t *> free;
+            std::vector<uint64_t *> owned; // every buffer this thread allocated
+        };
+        std::vector<Pool> pools;
+
+    public:
+        struct Slot
+        {
+            uint64_t *buffer;
+        };
+        using Taken = uint64_t *;
+
+        Pooled() : pools(size_t(omp_get_max_threads())) {}
+
+        // Buffers still in the queue are in some owned list as well
+        ~Pooled()
+        {
+            for (auto &pool : pools)
+                for (uint64_t *buffer : pool.owned)
+                    ::operator delete[](buffer, alignment);
+        }
+
+        Pooled(Pooled const &) = delete;
+        Pooled &operator=(Pooled const &) = delete;
+
+        void write(Slot &slot, value_t v)
+        {
+            Pool &pool = pools[omp_get_thread_num()];
+            if (pool.free.empty())
+            {
+                pool.owned.push_back(new (alignment) uint64_t[n_words]);
+                pool.free.push_back(pool.owned.back());
+            }
+            slot.buffer = pool.free.back();
+            pool.free.pop_back();
+            fill(slot.buffer, n_words, v);
+        }
+
+        Taken take(Slot const &slot) const { return slot.buffer; }
+
+        void consume(Taken buffer)
+        {
+            drain(buffer, n_words);
+            pools[omp_get_thread_num()].free.push_back(buffer);
+        }
+
+        size_t buffer_bytes() const { return N; }
+
+        size_t buffers_allocated() const
+        {
+            size_t to_rtn = 0;
+            for (auto const &pool : pools)
+                to_rtn += pool.owned.size();
+            return to_rtn;
+        }
+    };
+
+    // Calls f.template operator()<Policy>() with the policy of bytes and
+    // mode, bytes must be supported()
+    template <typename F>
+    auto dispatch(size_t bytes, Mode mode, F &&f)
+    {
+        bool pooled = mode == Mode::Pooled;
+        switch (bytes)
+        {
+        case 64:
+            return pooled ? f.template operator()<Pooled<64>>() : f.template operator()<Inline<64>>();
+        case 256:
+            return pooled ? f.template operator()<Pooled<256>>() : f.template operator()<Inline<256>>();
+        case 1024:
+            return pooled ? f.template operator()<Pooled<1024>>() : f.template operator()<Inline<1024>>();
+        default:
+            break;
+        }
+        return f.template operator()<None>();
+    }
+}; // namespace payload
@@ -0,0 +1,165 @@
+/*
+Per thread hardware performance counters through perf_event_open.
+
+Every benchmark thread opens its own set of counters (pid = 0, cpu = -1,
+user space only), enables them right before the timed region and reads
+them right after it. Events that the kernel refuses (no PMU in a VM,
+perf_event_paranoid, ...) are marked invalid and reported as NA; the
+benchmark itself is never affected.
+*/
+
+#pragma once
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+namespace perf
+{
+    enum Event
+    {
+        Cycles,
+        Instructions,
+        L1DMisses,
+        LLCMisses,
+        BranchMisses,
+        N_EVENTS
+    };
+
+    inline std::array<std::string, N_EVENTS> const names{
+        "cycles", "instructions", "l1d_misses", "llc_misses", "branch_misses"};
+
+    struct Counts
+    {
+        std::array<uint64_t, N_EVENTS> values{};
+        std::array<bool, N_EVENTS> valid{};
+    };
+
+    // Adds b to a, an event stays valid only if it was counted on both sides
+    inline void accumulate(Counts &a, Counts const &b)
+    {
+        for (int e = 0; e < N_EVENTS; ++e)
+        {
+            a.values[e] += b.values[e];
+            a.valid[e] = a.valid[e] && b.valid[e];
+        }
+    }
+
+    class ThreadCounters
+    {
+        std::array<int, N_EVENTS> fds;
+
+        static perf_event_attr attribute(Event event)
+        {
+            perf_event_attr attr;
+            std::memset(&attr, 0, sizeof(attr));
+            attr.size = sizeof(attr);
+            attr.disabled = 1;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED |
+                               PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+            switch (event)
+            {
+            case Cycles:
+                attr.type = PERF_TYPE_HARDWARE;
+                attr.config = PERF_COUNT_HW_CPU_CYCLES;
+                break;
+            case Instructions:
+                attr.type = PERF_TYPE_HARDWARE;
+                attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+                break;
+            case L1DMisses:
+                attr.type = PERF_TYPE_HW_CACHE;
+                attr.config = PERF_COUNT_HW_CACHE_L1D |
+                              (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                              (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+                break;
+            case LLCMisses:
+                attr.type = PERF_TYPE_HARDWARE;
+                attr.config = PERF_COUNT_HW_CACHE_MISSES;
+                break;
+            case BranchMisses:
+                attr.type = PERF_TYPE_HARDWARE;
+                attr.config = PERF_COUNT_HW_BRANCH_MISSES;
+                break;
+            default:
+                break;
+            }
+            return attr;
+        }
+
+    public:
+        ThreadCounters()
+        {
+            for (int e = 0; e < N_EVENTS; ++e)
+            {
+                perf_event_attr attr = attribute(Event(e));
+                fds[e] = static_cast<int>(
+                    syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+            }
+        }
+
+        ~ThreadCounters()
+        {
+            for (int fd : fds)
+                if (fd >= 0)
+                    close(fd);
+        }
+
+        ThreadCounters(ThreadCounters const &) = delete;
+        ThreadCounters &operator=(ThreadCounters const &) = delete;
+
+        bool any_available() const
+        {
+            for (int fd : fds)
+                if (fd >= 0)
+                    return true;
+            return false;
+        }
+
+        void start()
+        {
+            for (int fd : fds)
+            {
+                if (fd < 0)
+                    continue;
+                ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+                ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+            }
+        }
+
+        void stop()
+        {
+            for (int fd : fds)
+                if (fd >= 0)
+                    ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+        }
+
+        // Values are scaled up if the kernel had to multiplex the counters
+        Counts read_counts() const
+        {
+            Counts to_rtn{};
+            for (int e = 0; e < N_EVENTS; ++e)
+            {
+                if (fds[e] < 0)
+                    continue;
+
+                uint64_t buf[3]; // value, time enabled, time running
+                if (::read(fds[e], buf, sizeof(buf)) != sizeof(buf) || buf[2] == 0)
+                    continue;
+
+                double scale = double(buf[1]) / double(buf[2]);
+                to_rtn.values[e] = static_cast<uint64_t>(buf[0] * scale);
+                to_rtn.valid[e] = true;
+            }
+            return to_rtn;
+        }
+    };
+}; // namespace perf
@@ -0,0 +1,133 @@
+/*
+Registry of the queue implementations that can be benchmarked.
+
+The CLI, the sweep driver and the Python bindings look queues up by the
+name used on the command line instead of chaining string comparisons.
+Every factory builds either the plain queue or the one instrumented with
+instrumentation::Counting, with the backoff policy of backoff.hpp used on
+contended locks and failed CASes and the payload policy of payload.hpp
+(message size and inline / pooled). Every combination is instantiated, so
+only the sizes in payload::sizes are available. The queues whose threads
+share a size counter also take the size tracking policy of sizing.hpp
+(sized_factory), the others ignore it. global_lock_heap and skiplist are
+priority queues (is_priority), pop returns the smallest value.
+*/
+
+#pragma once
+#include "backoff.hpp"
+#include "base_queue.hpp"
+#include "baskets.hpp"
+#include "elimination.hpp"
+#include "fine_lock.hpp"
+#include "hybrid.hpp"
+#include "instrumentation.hpp"
+#include "lock_free_aba.hpp"
+#include "lock_guard.hpp"
+#include "optimistic.hpp"
+#include "payload.hpp"
+#include "sequential.hpp"
+#include "sizing.hpp"
+#include "skiplist.hpp"
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace queues
+{
+    using Factory = std::function<std::unique_ptr<BaseQueue>(bool instrumented, backoff::Kind,
+                                                             backoff::Parameters const &,
+                                                             size_t payload_bytes, payload::Mode,
+                                                             sizing::Kind)>;
+
+    template <template <typename, typename, typename> class Q>
+    Factory factory()
+    {
+        return [](bool instrumented, backoff::Kind kind, backoff::Parameters const &parameters,
+                  size_t payload_bytes, payload::Mode mode, sizing::Kind)
+        {
+            return backoff::dispatch(kind, [&]<typename Backoff>()
+                                     { return payload::dispatch(payload_bytes, mode, [&]<typename Payload>() -> std::unique_ptr<BaseQueue>
+                                                                {
+                if (instrumented)
+                    return std::make_unique<Q<instrumentation::Counting, Backoff, Payload>>(Backoff{parameters});
+                return std::make_unique<Q<instrumentation::None, Backoff, Payload>>(Backoff{parameters}); }); });
+        };
+    }
+
+    template <template <typename, typename, typename, typename> class Q>
+    Factory sized_factory()
+    {
+        return [](bool instrumented, backoff::Kind kind, backoff::Parameters const &parameters,
+                  size_t payload_bytes, payload::Mode mode, sizing::Kind tracking)
+        {
+            return backoff::dispatch(kind, [&]<typename Backoff>()
+                                     { return payload::dispatch(payload_bytes, mode, [&]<typename Payload>()
+                                                                { return sizing::dispatch(tracking, [&]<typename Size>() -> std::unique_ptr<BaseQueue>
+                                                                                          {
+                if (instrumented)
+                    return std::make_unique<Q<instrumentation::Counting, Backoff, Payload, Size>>(Backoff{parameters});
+                return std::make_unique<Q<instrumentation::None, Backoff, Payload, Size>>(Backoff{parameters}); }); }); });
+        };
+    }
+
+    inline std::map<std::string, Factory> const &registry()
+    {
+        static const std::map<std::string, Factory> factories{
+            {"sequential", factory<seq::BasicQueue>()},
+            {"global_lock", factory<global_lock::BasicQueue>()},
+            {"fine_lock", sized_factory<fine_lock::BasicQueue>()},
+            {"lock_free", sized_factory<lock_free_aba::BasicQueue>()},
+            {"elimination", sized_factory<elimination::BasicQueue>()},
+            {"baskets", sized_factory<baskets::BasicQueue>()},
+            {"optimistic", sized_factory<optimistic::BasicQueue>()},
+            {"hybrid", sized_factory<hybrid::BasicQueue>()},
+            {"global_lock_heap", factory<global_lock::BasicHeap>()},
+            {"skiplist", sized_factory<skiplist::BasicQueue>()},
+        };
+        return factories;
+    }
+
+    inline bool exists(std::string const &type)
+    {
+        return registry().count(type) != 0;
+    }
+
+    // nullptr for unknown types or unsupported payload sizes. The per thread
+    // free lists are sized with omp_get_max_threads(), so set the team size
+    // before calling this.
+    inline std::unique_ptr<BaseQueue> make_queue(std::string const &type, bool instrumented = false,
+                                                 backoff::Kind kind = backoff::Kind::None,
+                                                 size_t payload_bytes = 0,
+                                                 payload::Mode mode = payload::Mode::Inline,
+                                                 backoff::Parameters const &parameters = {},
+                                                 sizing::Kind tracking = sizing::Kind::Shared)
+    {
+        auto it = registry().find(type);
+        if (it == registry().end() || !payload::supported(payload_bytes))
+            return nullptr;
+        return it->second(instrumented, kind, parameters, payload_bytes, mode, tracking);
+    }
+
+    inline std::vector<std::string> names()
+    {
+        std::vector<std::string> to_rtn;
+        for (auto const &[name, factory] : registry())
+            to_rtn.push_back(name);
+        return to_rtn;
+    }
+
+    // Queues that must only be used by a single thread
+    inline bool is_sequential(std::string const &type)
+    {
+        return type == "sequential";
+    }
+
+    // Queues that pop the smallest value instead of the oldest one
+    inline bool is_priority(std::string const &type)
+    {
+        return type == "global_lock_heap" || type == "skiplist";
+    }
+}; // namespace queues
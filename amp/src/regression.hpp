@@ -0,0 +1,250 @@
+/*
+Performance regression gate against a stored baseline (--compare).
+
+The baseline is a results file written with --output: one JSON record per
+line, each with the full config and the throughput of every repetition.
+Every record whose queue type is in the registry is rerun with the same
+config, and the two sets of per repetition throughputs are compared:
+
+  throughput : regressed if the median dropped by more than the threshold
+               and a one sided Mann-Whitney test says the drop is
+               significant (p <= alpha)
+  latency    : if the baseline was run with --latency_sample, regressed if
+               the push or pop p99 grew by more than the threshold. The
+               histograms have log2 buckets, so in practice this flags a
+               p99 that moved up by at least one bucket (2x).
+
+A significant result needs a few repetitions on both sides: with 3 against
+3 the smallest possible p is 0.05, with 4 against 4 it is 1/70.
+*/
+
+#pragma once
+#include "benchmark.hpp"
+#include "json.hpp"
+#include "queues.hpp"
+#include "statistics.hpp"
+
+#include <omp.h>
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace regression
+{
+    struct Options
+    {
+        double threshold{0.05}; // relative change that counts
+        double alpha{0.05};     // significance level of the throughput test
+    };
+
+    struct Baseline
+    {
+        std::string name; // queue type
+        size_t line{};    // in the baseline file
+        Config config{};
+        bool instrumented{false};
+        std::vector<double> throughputs; // per repetition
+        double push_p99{-1.0};           // -1 if not recorded
+        double pop_p99{-1.0};
+    };
+
+    struct Verdict
+    {
+        Baseline const *baseline{};
+        std::string skipped; // reason, empty if the record was rerun
+        std::vector<double> throughputs;
+        double baseline_median{};
+        double median{};
+        double change{}; // relative, negative is slower
+        double p_value{1.0};
+        double push_p99{-1.0};
+        double pop_p99{-1.0};
+        bool throughput_regressed{false};
+        bool latency_regressed{false};
+
+        bool regressed() const { return throughput_regressed || latency_regressed; }
+    };
+
+    inline double median(std::vector<double> const &values)
+    {
+        return stats::describe(values).median;
+    }
+
+    // Rebuilds the Config of a record written by Benchmark::save_results
+    inline bool to_config(json::Value const &record, Config &config)
+    {
+        json::Value const *c = record.find("config");
+        if (!c)
+            return false;
+
+        config = Config{};
+        config.num_threads = size_t(c->number_or("num_threads", 0));
+        config.repetitions = size_t(c->number_or("repetitions", 0));
+        config.max_time_in_s = int(c->number_or("max_time_in_s", 0));
+        config.warmup_time_in_s = c->number_or("warmup_time_in_s", 0);
+        config.sets = size_t(c->number_or("sets", 0));
+        config.seed = int(c->number_or("seed", 42));
+        config.verify = c->bool_or("verify", false);
+        config.latency_sample = size_t(c->number_or("latency_sample", 0));
+        config.recipe = c->string_or("recipe", "balanced") == to_string(ConfigRecipe::ThreadSpecific)
+                            ? ConfigRecipe::ThreadSpecific
+                            : ConfigRecipe::Balanced;
+        affinity::from_string(c->string_or("placement", "none"), config.placement);
+        backoff::from_string(c->string_or("backoff", "none"), config.backoff);
+        config.backoff_parameters.min_spins = unsigned(c->number_or("backoff_min_spins", 4));
+        config.backoff_parameters.max_spins = unsigned(c->number_or("backoff_max_spins", 1024));
+        config.payload_bytes = size_t(c->number_or("payload_bytes", 0));
+        payload::from_string(c->string_or("payload_mode", "inline"), config.payload_mode);
+        sizing::from_string(c->string_or("size_tracking", "shared"), config.size_tracking);
+        config.cpu_list = c->numbers<int>("cpu_list");
+        config.batch_enque = c->numbers<int>("batch_enque");
+        config.batch_deque = c->numbers<int>("batch_deque");
+        return config.num_threads > 0 && config.repetitions > 0;
+    }
+
+    // Records of a results file. Lines that are not benchmark records (e.g.
+    // of the lock benchmark) come back with an empty config and are skipped
+    // by compare().
+    inline std::vector<Baseline> load(std::string const &path, std::string &error)
+    {
+        std::vector<Baseline> to_rtn;
+        std::ifstream in(path);
+        if (!in)
+        {
+            error = "cannot open " + path;
+            return to_rtn;
+        }
+
+        std::string line;
+        for (size_t n = 1; std::getline(in, line); ++n)
+        {
+            if (line.empty())
+                continue;
+            std::optional<json::Value> record = json::parse(line);
+            if (!record || record->type != json::Value::Type::Object)
+            {
+                error = path + ":" + std::to_string(n) + ": not a JSON record";
+                return {};
+            }
+
+            Baseline b;
+            b.name = record->string_or("name", "");
+            b.line = n;
+            if (!to_config(*record, b.config))
+                b.config.num_threads = 0;
+            b.instrumented = record->at_path({"summary", "contention"}) != nullptr;
+            if (json::Value const *samples = record->find("samples"))
+                for (auto const &s : samples->array)
+                    b.throughputs.push_back(s.number_or("throughput", 0));
+            if (json::Value const *p = record->at_path({"summary", "latency_ns", "push"}))
+                b.push_p99 = p->number_or("p99", -1.0);
+            if (json::Value const *p = record->at_path({"summary", "latency_ns", "pop"}))
+                b.pop_p99 = p->number_or("p99", -1.0);
+            to_rtn.push_back(std::move(b));
+        }
+        return to_rtn;
+    }
+
+    // Reruns one baseline record. output, if not empty, gets the new record.
+    inline Verdict compare(Baseline const &baseline, Options const &options,
+                           hwbench::Characterization const *hardware, std::string const &output)
+    {
+        Verdict to_rtn{};
+        to_rtn.baseline = &baseline;
+
+        Config config = baseline.config;
+        if (!queues::exists(baseline.name))
+            to_rtn.skipped = "not a queue type";
+        else if (config.num_threads == 0)
+            to_rtn.skipped = "no config";
+        else if (queues::is_sequential(baseline.name) && config.num_threads != 1)
+            to_rtn.skipped = "sequential with more than one thread";
+        else if (!config.is_config_correct())
+            to_rtn.skipped = "invalid config";
+        else if (baseline.throughputs.empty())
+            to_rtn.skipped = "no samples";
+        if (!to_rtn.skipped.empty())
+            return to_rtn;
+
+        bool timed = config.max_time_in_s != 0;
+        omp_set_num_threads(int(config.num_threads));
+        Benchmark benchmark{std::move(config)};
+        benchmark.set_hardware(hardware);
+        Config const &c = benchmark.get_config();
+        auto queue = queues::make_queue(baseline.name, baseline.instrumented, c.backoff,
+                                        c.payload_bytes, c.payload_mode, c.backoff_parameters,
+                                        c.size_tracking);
+        if (timed)
+            benchmark.run_fast(*queue);
+        else
+            benchmark.run_sets(*queue);
+        if (!output.empty())
+            benchmark.save_results(output, baseline.name);
+
+        Results const &results = benchmark.get_results();
+        for (auto const &s : results.samples)
+            to_rtn.throughputs.push_back(s.throughput);
+
+        to_rtn.baseline_median = median(baseline.throughputs);
+        to_rtn.median = median(to_rtn.throughputs);
+        to_rtn.change = to_rtn.baseline_median > 0
+                            ? to_rtn.median / to_rtn.baseline_median - 1.0
+                            : 0.0;
+        to_rtn.p_value = stats::mann_whitney_less(to_rtn.throughputs, baseline.throughputs);
+        to_rtn.throughput_regressed = to_rtn.change < -options.threshold &&
+                                      to_rtn.p_value <= options.alpha;
+
+        if (benchmark.get_config().latency_sample > 0)
+        {
+            to_rtn.push_p99 = results.push_latency.quantile(0.99);
+            to_rtn.pop_p99 = results.pop_latency.quantile(0.99);
+            auto worse = [&](double before, double after)
+            { return before > 0 && after > before * (1.0 + options.threshold); };
+            to_rtn.latency_regressed = worse(baseline.push_p99, to_rtn.push_p99) ||
+                                       worse(baseline.pop_p99, to_rtn.pop_p99);
+        }
+        return to_rtn;
+    }
+
+    inline void print(std::ostream &out, std::vector<Verdict> const &verdicts, Options const &options)
+    {
+        out << "Comparison against the baseline (threshold " << options.threshold * 100
+            << "%, alpha " << options.alpha << ")\n";
+        out << std::left << std::setw(6) << "line" << std::setw(14) << "name" << std::setw(9) << "threads"
+            << std::setw(10) << "recipe" << std::setw(15) << "base [ops/s]" << std::setw(15) << "new [ops/s]"
+            << std::setw(10) << "change" << std::setw(9) << "p" << "verdict\n";
+
+        for (auto const &v : verdicts)
+        {
+            Baseline const &b = *v.baseline;
+            out << std::left << std::setw(6) << b.line << std::setw(14) << b.name;
+            if (!v.skipped.empty())
+            {
+                out << "skipped: " << v.skipped << "\n";
+                continue;
+            }
+
+            std::ostringstream change;
+            change << std::fixed << std::setprecision(1) << std::showpos << v.change * 100 << "%";
+            out << std::setw(9) << b.config.num_threads << std::setw(10) << to_string(b.config.recipe)
+                << std::setw(15) << std::setprecision(4) << v.baseline_median
+                << std::setw(15) << v.median << std::setw(10) << change.str()
+                << std::setw(9) << std::setprecision(3) << v.p_value;
+            if (!v.regressed())
+                out << "ok";
+            if (v.throughput_regressed)
+                out << "THROUGHPUT REGRESSED" << (v.latency_regressed ? ", " : "");
+            if (v.latency_regressed)
+                out << "P99 REGRESSED (push " << b.push_p99 << " -> " << v.push_p99
+                    << " ns, pop " << b.pop_p99 << " -> " << v.pop_p99 << " ns)";
+            out << "\n";
+        }
+        out << std::flush;
+    }
+}; // namespace regression
@@ -0,0 +1,211 @@
+/*
+Scalability models fitted to the throughput of a thread sweep.
+
+Universal Scalability Law (Gunther):
+
+  X(N) = lambda N / (1 + sigma (N - 1) + kappa N (N - 1))
+
+lambda is the throughput of one thread without any sharing, sigma the
+contention (serialized fraction, Amdahl's law is the special case
+kappa = 0) and kappa the coherency cost that makes throughput fall again
+past the peak at N* = sqrt((1 - sigma) / kappa).
+
+For a fixed lambda, N lambda / X - 1 = sigma (N - 1) + kappa N (N - 1) is
+linear in the coefficients, and for fixed coefficients the best lambda is
+a one dimensional least squares problem. The fit alternates the two until
+it settles, keeping sigma and kappa >= 0. Every repetition of every thread
+count is one data point.
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace scalability
+{
+    struct Point
+    {
+        int threads{};
+        double throughput{};
+    };
+
+    struct Fit
+    {
+        double lambda{};
+        double sigma{};
+        double kappa{};
+        double r_squared{};
+        bool valid{false}; // needs three distinct thread counts
+
+        double predict(double n) const
+        {
+            return lambda * n / (1.0 + sigma * (n - 1.0) + kappa * n * (n - 1.0));
+        }
+
+        // Thread count of the maximum, -1 if throughput never drops
+        double peak_threads() const
+        {
+            if (kappa <= 0)
+                return -1.0;
+            return std::sqrt(std::max(1.0 - sigma, 0.0) / kappa);
+        }
+    };
+
+    // Least squares y = a x1 + b x2 with a, b >= 0 (b fixed to 0 if !with_b)
+    inline void solve_nonnegative(std::vector<double> const &x1, std::vector<double> const &x2,
+                                  std::vector<double> const &y, bool with_b, double &a, double &b)
+    {
+        double s11 = 0, s12 = 0, s22 = 0, s1y = 0, s2y = 0;
+        for (size_t i = 0; i < y.size(); ++i)
+        {
+            s11 += x1[i] * x1[i];
+            s12 += x1[i] * x2[i];
+            s22 += x2[i] * x2[i];
+            s1y += x1[i] * y[i];
+            s2y += x2[i] * y[i];
+        }
+
+        a = b = 0;
+        double det = s11 * s22 - s12 * s12;
+        if (with_b && det > 0)
+        {
+            a = (s1y * s22 - s2y * s12) / det;
+            b = (s2y * s11 - s1y * s12) / det;
+            if (a >= 0 && b >= 0)
+                return;
+        }
+        // One of them on the boundary: best of the two single fits
+        double a_only = s11 > 0 ? std::max(s1y / s11, 0.0) : 0.0;
+        double b_only = with_b && s22 > 0 ? std::max(s2y / s22, 0.0) : 0.0;
+        double err_a = -2 * a_only * s1y + a_only * a_only * s11;
+        double err_b = -2 * b_only * s2y + b_only * b_only * s22;
+        if (err_a <= err_b)
+            a = a_only, b = 0;
+        else
+            a = 0, b = b_only;
+    }
+
+    // USL, or Amdahl with amdahl = true (kappa = 0)
+    inline Fit fit(std::vector<Point> const &points, bool amdahl = false)
+    {
+        Fit to_rtn{};
+        std::vector<int> distinct;
+        for (auto const &p : points)
+            if (p.throughput > 0 && std::find(distinct.begin(), distinct.end(), p.threads) == distinct.end())
+                distinct.push_back(p.threads);
+        if (distinct.size() < (amdahl ? 2u : 3u))
+            return to_rtn;
+
+        // Start from the per thread throughput at the smallest thread count
+        int n_min = *std::min_element(distinct.begin(), distinct.end());
+        double sum = 0;
+        int count = 0;
+        for (auto const &p : points)
+            if (p.threads == n_min && p.throughput > 0)
+            {
+                sum += p.throughput;
+                ++count;
+            }
+        to_rtn.lambda = sum / count / n_min;
+
+        std::vector<double> x1, x2, y;
+        for (int iteration = 0; iteration < 100; ++iteration)
+        {
+            x1.clear();
+            x2.clear();
+            y.clear();
+            for (auto const &p : points)
+            {
+                if (p.throughput <= 0)
+                    continue;
+                double n = p.threads;
+                x1.push_back(n - 1);
+                x2.push_back(n * (n - 1));
+                y.push_back(n * to_rtn.lambda / p.throughput - 1);
+            }
+            solve_nonnegative(x1, x2, y, !amdahl, to_rtn.sigma, to_rtn.kappa);
+
+            // Best lambda for these coefficients
+            double num = 0, den = 0;
+            for (auto const &p : points)
+            {
+                if (p.throughput <= 0)
+                    continue;
+                double g = to_rtn.predict(p.threads) / to_rtn.lambda;
+                num += p.throughput * g;
+                den += g * g;
+            }
+            double lambda = num / den;
+            bool settled = std::abs(lambda - to_rtn.lambda) <= 1e-9 * to_rtn.lambda;
+            to_rtn.lambda = lambda;
+            if (settled)
+                break;
+        }
+
+        double mean = 0;
+        size_t n = 0;
+        for (auto const &p : points)
+            if (p.throughput > 0)
+            {
+                mean += p.throughput;
+                ++n;
+            }
+        mean /= double(n);
+        double ss_res = 0, ss_tot = 0;
+        for (auto const &p : points)
+            if (p.throughput > 0)
+            {
+                double r = p.throughput - to_rtn.predict(p.threads);
+                ss_res += r * r;
+                ss_tot += (p.throughput - mean) * (p.throughput - mean);
+            }
+        to_rtn.r_squared = ss_tot > 0 ? 1.0 - ss_res / ss_tot : 1.0;
+        to_rtn.valid = true;
+        return to_rtn;
+    }
+
+    // One line per series: USL and Amdahl coefficients, the peak and, with
+    // predict_threads > 0, the predicted throughput there
+    inline void print(std::ostream &out, std::map<std::string, std::vector<Point>> const &series,
+                      int predict_threads)
+    {
+        out << "Scalability fit (USL: X(N) = lambda N / (1 + sigma (N-1) + kappa N (N-1)))\n";
+        out << std::left << std::setw(32) << "series" << std::setw(13) << "lambda" << std::setw(11) << "sigma"
+            << std::setw(11) << "kappa" << std::setw(8) << "r2" << std::setw(10) << "peak N"
+            << std::setw(13) << "peak X" << std::setw(12) << "amdahl s";
+        if (predict_threads > 0)
+            out << "X(" << predict_threads << ")";
+        out << "\n";
+
+        for (auto const &[name, points] : series)
+        {
+            Fit usl = fit(points);
+            out << std::left << std::setw(32) << name;
+            if (!usl.valid)
+            {
+                out << "needs at least three thread counts\n";
+                continue;
+            }
+            Fit amdahl = fit(points, true);
+            double peak = usl.peak_threads();
+            out << std::setprecision(4) << std::setw(13) << usl.lambda << std::setw(11) << usl.sigma
+                << std::setw(11) << usl.kappa << std::setw(8) << std::setprecision(3) << usl.r_squared
+                << std::setprecision(4);
+            if (peak > 0)
+                out << std::setw(10) << peak << std::setw(13) << usl.predict(peak);
+            else
+                out << std::setw(10) << "none" << std::setw(13) << "-";
+            out << std::setw(12) << amdahl.sigma;
+            if (predict_threads > 0)
+                out << usl.predict(predict_threads);
+            out << "\n";
+        }
+        out << std::flush;
+    }
+}; // namespace scalability
@@ -0,0 +1,225 @@
+/*
+Per producer sequence verification, cheap enough to run inside run_fast.
+
+Every pushed value encodes (producer id, sequence number), see
+generics::encode. Per pop a consumer does O(1) work:
+
+  - it sets the bit of the value in the producer's bitmap; a bit that was
+    already set is a duplicate,
+  - it compares the sequence number with the last one it got from the same
+    producer; FIFO order means a single consumer sees every producer's
+    values in increasing order, anything else is a reordering.
+    The priority queues (queues::is_priority) keep this order as well,
+    a producer's values grow with the sequence number.
+
+Bitmaps are allocated in chunks of 2^20 sequence numbers by the producer
+itself, before it pushes the first value of a chunk, so consumers never
+allocate. After the queue is drained, every pushed value whose bit is not
+set is lost.
+*/
+
+#pragma once
+#include "generics.hpp"
+
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace sequence_check
+{
+    using value_t = generics::value_t;
+
+    struct Report
+    {
+        uint64_t pushed{};
+        uint64_t popped{};
+        uint64_t lost{};
+        uint64_t duplicated{};
+        uint64_t reordered{};
+        uint64_t unknown{}; // values no producer pushed
+
+        bool ok() const { return lost + duplicated + reordered + unknown == 0; }
+
+        Report &operator+=(Report const &other)
+        {
+            pushed += other.pushed;
+            popped += other.popped;
+            lost += other.lost;
+            duplicated += other.duplicated;
+            reordered += other.reordered;
+            unknown += other.unknown;
+            return *this;
+        }
+    };
+
+    // Sequence numbers seen from one producer
+    class SeenSet
+    {
+    public:
+        static constexpr uint64_t chunk_bits = 20;
+        static constexpr uint64_t chunk_size = uint64_t(1) << chunk_bits;
+        static constexpr uint64_t max_chunks = uint64_t(1) << 14;
+
+    private:
+        static constexpr uint64_t words_per_chunk = chunk_size / 64;
+        std::unique_ptr<std::atomic<std::atomic<uint64_t> *>[]> chunks;
+
+    public:
+        SeenSet() : chunks(new std::atomic<std::atomic<uint64_t> *>[max_chunks])
+        {
+            for (uint64_t c = 0; c < max_chunks; ++c)
+                chunks[c].store(nullptr, std::memory_order_relaxed);
+        }
+
+        ~SeenSet()
+        {
+            if (!chunks)
+                return;
+            for (uint64_t c = 0; c < max_chunks; ++c)
+                delete[] chunks[c].load(std::memory_order_relaxed);
+        }
+
+        SeenSet(SeenSet &&) = default;
+        SeenSet &operator=(SeenSet &&) = default;
+
+        // Producer side, before pushing sequence. False once out of space.
+        bool reserve(uint64_t sequence)
+        {
+            uint64_t c = sequence >> chunk_bits;
+            if (c >= max_chunks)
+                return false;
+            if (chunks[c].load(std::memory_order_relaxed) == nullptr)
+            {
+                auto *words = new std::atomic<uint64_t>[words_per_chunk];
+                for (uint64_t w = 0; w < words_per_chunk; ++w)
+                    words[w].store(0, std::memory_order_relaxed);
+                chunks[c].store(words, std::memory_order_release);
+            }
+            return true;
+        }
+
+        enum class Mark
+        {
+            First,
+            Duplicate,
+            Unknown
+        };
+
+        // Consumer side
+        Mark mark(uint64_t sequence)
+        {
+            uint64_t c = sequence >> chunk_bits;
+            if (c >= max_chunks)
+                return Mark::Unknown;
+            auto *words = chunks[c].load(std::memory_order_acquire);
+            if (words == nullptr)
+                return Mark::Unknown;
+
+            uint64_t offset = sequence & (chunk_size - 1);
+            uint64_t bit = uint64_t(1) << (offset & 63);
+            uint64_t old = words[offset >> 6].fetch_or(bit, std::memory_order_relaxed);
+            return (old & bit) ? Mark::Duplicate : Mark::First;
+        }
+
+        // Number of distinct sequence numbers below end that were seen
+        uint64_t count(uint64_t end) const
+        {
+            uint64_t to_rtn = 0;
+            for (uint64_t c = 0; c < max_chunks && (c << chunk_bits) < end; ++c)
+            {
+                auto *words = chunks[c].load(std::memory_order_acquire);
+                if (words == nullptr)
+                    continue;
+                for (uint64_t w = 0; w < words_per_chunk; ++w)
+                    to_rtn += std::popcount(words[w].load(std::memory_order_relaxed));
+            }
+            return to_rtn;
+        }
+    };
+
+    class Verifier
+    {
+        struct alignas(64) Producer
+        {
+            SeenSet seen;
+            uint64_t pushed = 0;
+        };
+
+        struct alignas(64) Consumer
+        {
+            std::vector<int64_t> last_seen; // per producer, -1 before the first
+            Report report{};
+        };
+
+        std::vector<Producer> producers;
+        std::vector<Consumer> consumers;
+
+    public:
+        explicit Verifier(size_t n_threads) : producers(n_threads), consumers(n_threads)
+        {
+            for (auto &c : consumers)
+                c.last_seen.assign(n_threads, -1);
+        }
+
+        // Value the producer pushes next, or false once its bitmap is full
+        bool next_value(uint producer, value_t &v)
+        {
+            Producer &p = producers[producer];
+            if ((p.pushed & (SeenSet::chunk_size - 1)) == 0 && !p.seen.reserve(p.pushed))
+                return false;
+            v = generics::encode(producer, p.pushed);
+            return true;
+        }
+
+        // The value handed out by next_value was pushed successfully
+        void pushed(uint producer) { producers[producer].pushed++; }
+
+        void popped(uint consumer, value_t v)
+        {
+            Consumer &c = consumers[consumer];
+            c.report.popped++;
+
+            uint64_t producer = generics::producer_of(v);
+            uint64_t sequence = generics::sequence_of(v);
+            if (v < 0 || producer >= producers.size())
+            {
+                c.report.unknown++;
+                return;
+            }
+
+            switch (producers[producer].seen.mark(sequence))
+            {
+            case SeenSet::Mark::Unknown:
+                c.report.unknown++;
+                return;
+            case SeenSet::Mark::Duplicate:
+                c.report.duplicated++;
+                return;
+            case SeenSet::Mark::First:
+                break;
+            }
+
+            int64_t &last = c.last_seen[producer];
+            if (int64_t(sequence) < last)
+                c.report.reordered++;
+            else
+                last = int64_t(sequence);
+        }
+
+        // Call after the queue has been drained
+        Report report() const
+        {
+            Report to_rtn{};
+            for (auto const &c : consumers)
+                to_rtn += c.report;
+            for (auto const &p : producers)
+            {
+                to_rtn.pushed += p.pushed;
+                to_rtn.lost += p.pushed - p.seen.count(p.pushed);
+            }
+            return to_rtn;
+        }
+    };
+}; // namespace sequence_check
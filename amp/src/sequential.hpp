@@ -4,6 +4,9 @@
 #include <vector>
 #include "generics.hpp"
 #include "base_queue.hpp"
+#include "backoff.hpp"
+#include "instrumentation.hpp"
+#include "payload.hpp"
 
 namespace seq
 {
@@ -12,21 +15,27 @@ value_t empty_val = generics::empty_val;
 
 
 
-struct Node
+// Slot is the message of the payload policy (payload.hpp)
+template <typename Slot>
+struct BasicNode
 {
-    Node *next;
+    BasicNode *next;
     value_t value;
+    [[no_unique_address]] Slot payload;
 };
+using Node = BasicNode<payload::None::Slot>;
 
-class FreeList
+template <typename Node>
+class BasicFreeList
 {
     Node *header = nullptr;
     unsigned int size = 0;
+    size_t allocated = 0;
 
   public:
-    FreeList() = default;
+    BasicFreeList() = default;
 
-    ~FreeList()
+    ~BasicFreeList()
     {
         Node *walker = header;
         while (walker != nullptr)
@@ -37,10 +46,10 @@ class FreeList
         }
     }
 
-    FreeList(FreeList const &other) = delete;
-    FreeList(FreeList &&other) = delete;
-    FreeList &operator=(FreeList const &other) = delete;
-    FreeList &operator=(FreeList &&other) = delete;
+    BasicFreeList(BasicFreeList const &other) = delete;
+    BasicFreeList(BasicFreeList &&other) = delete;
+    BasicFreeList &operator=(BasicFreeList const &other) = delete;
+    BasicFreeList &operator=(BasicFreeList &&other) = delete;
 
     void push(Node *n)
     {
@@ -49,45 +58,47 @@ class FreeList
         size++;
     }
 
-    Node *get(value_t val)
+    // Any free node will do, the caller overwrites the value
+    Node *get()
     {
         if (header == nullptr)
             return nullptr;
 
-        if (header->value == val)
-        {
-            Node *to_rtn = header;
-            header = header->next;
-            size--;
-            return to_rtn;
-        }
-
-        auto walker = header;
-        while (walker->next != nullptr)
-        {
-            if (walker->next->value == val)
-            {
-                auto to_rtn = walker->next;
-                walker->next = walker->next->next;
-                size--;
-                return to_rtn;
-            }
-            walker = walker->next;
-        }
+        Node *to_rtn = header;
+        header = header->next;
+        size--;
+        return to_rtn;
+    }
 
-        return nullptr;
+    // Counts the nodes the owner had to allocate because the list was empty
+    Node *allocate()
+    {
+        ++allocated;
+        return new Node;
     }
+
+    size_t get_allocated() const { return allocated; }
+    unsigned int get_size() const { return size; }
 };
+using FreeList = BasicFreeList<Node>;
 
-class Queue: public BaseQueue
+// Backoff is accepted for a uniform registry, a single thread never waits
+template <typename Instr = instrumentation::None, typename Backoff = backoff::None,
+          typename Payload = payload::None>
+class BasicQueue: public BaseQueue
 { // FIFO
+    using Node = BasicNode<typename Payload::Slot>;
+    using FreeList = BasicFreeList<Node>;
+
     Node *header;
     Node *tail;
     FreeList freelist;
     unsigned int size;
+    Instr instr;
+    Payload messages;
 
   public:
-    Queue()
+    explicit BasicQueue(Backoff = Backoff{})
     {
         header = new Node;
         header->next = nullptr;
@@ -96,7 +107,7 @@ class Queue: public BaseQueue
         size = 0;
     };
 
-    ~Queue()
+    ~BasicQueue()
     {
         Node *walker = header;
         while (walker != nullptr)
@@ -109,12 +120,12 @@ class Queue: public BaseQueue
 
     bool push(value_t val) override
     {
-        Node *n = freelist.get(val);
+        Node *n = freelist.get();
+        instr.freelist(n != nullptr);
         if (n == nullptr)
-        {
-            n = new Node;
-            n->value = val;
-        }
+            n = freelist.allocate();
+        n->value = val;
+        messages.write(n->payload, val);
         n->next = nullptr;
         tail->next = n;
         tail = n;
@@ -129,6 +140,7 @@ class Queue: public BaseQueue
 
         Node *current = header->next;
         value_t val = current->value;
+        messages.consume(messages.take(current->payload));
 
         header->next = current->next;
         if (current == tail)
@@ -141,13 +153,25 @@ class Queue: public BaseQueue
 
     int get_size() override {return size;}
 
+    std::optional<instrumentation::Contention> contention() const override { return instr.contention(); }
+    void reset_contention() override { instr.reset(); }
+
+    std::optional<memory::Allocation> allocation() const override
+    {
+        // + 1 for the dummy node
+        return memory::Allocation{sizeof(Node), freelist.get_allocated() + 1, {freelist.get_size()},
+                                  messages.buffer_bytes(), messages.buffers_allocated()};
+    }
+
     Node const *get_head() const { return header; }
     Node const *get_tail() const { return tail; }
 
-    Queue(Queue const &other) = delete;
-    Queue(Queue &&other) = delete;
+    BasicQueue(BasicQueue const &other) = delete;
+    BasicQueue(BasicQueue &&other) = delete;
 
-    Queue &operator=(Queue const &other) = delete;
-    Queue &operator=(Queue &&other) = delete;
+    BasicQueue &operator=(BasicQueue const &other) = delete;
+    BasicQueue &operator=(BasicQueue &&other) = delete;
 };
+
+using Queue = BasicQueue<>;
 }; // namespace seq
\ No newline at end of file
@@ -0,0 +1,159 @@
+/*
+Size tracking policies for the concurrent queues, the fourth template
+parameter after instrumentation, backoff and payload. A queue calls
+
+  pushed()  : after an element was linked
+  popped()  : after an element was unlinked
+  get()     : the size for get_size()
+
+Shared is the single std::atomic<int> the queues always had, every push and
+pop of every thread hits its cache line. None tracks nothing and reports -1.
+Sharded keeps one counter per thread (indexed with omp_get_thread_num(),
+so build the queue after setting the team size), written only by its owner
+and summed by get(). Tickets keeps the number of pushes and the number of
+pops on two cache lines, so producers and consumers no longer share one.
+
+get() of Sharded and Tickets is not a snapshot, concurrent operations may
+or may not be counted. A negative sum is reported as 0.
+
+Only the queues whose threads actually share the counter take the policy
+(fine_lock, lock_free and the queues built like it), sequential and
+global_lock count under their lock.
+*/
+
+#pragma once
+#include <omp.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace sizing
+{
+    enum class Kind
+    {
+        Shared,
+        None,
+        Sharded,
+        Tickets
+    };
+
+    inline std::string to_string(Kind kind)
+    {
+        switch (kind)
+        {
+        case Kind::Shared:
+            return "shared";
+        case Kind::None:
+            return "none";
+        case Kind::Sharded:
+            return "sharded";
+        case Kind::Tickets:
+            return "tickets";
+        }
+        return "unknown";
+    }
+
+    inline bool from_string(std::string const &name, Kind &kind)
+    {
+        static const std::map<std::string, Kind> names{
+            {"shared", Kind::Shared},
+            {"none", Kind::None},
+            {"sharded", Kind::Sharded},
+            {"tickets", Kind::Tickets}};
+
+        auto it = names.find(name);
+        if (it == names.end())
+            return false;
+        kind = it->second;
+        return true;
+    }
+
+    inline int clamp(int64_t size)
+    {
+        return int(std::max<int64_t>(size, 0));
+    }
+
+    struct Shared
+    {
+        alignas(64) std::atomic<int> count{0};
+
+        void pushed() { count.fetch_add(1, std::memory_order_relaxed); }
+        void popped() { count.fetch_sub(1, std::memory_order_relaxed); }
+        int get() const { return count.load(std::memory_order_relaxed); }
+    };
+
+    struct None
+    {
+        void pushed() {}
+        void popped() {}
+        int get() const { return -1; }
+    };
+
+    class Sharded
+    {
+        // Pushes minus pops of one thread, negative for pure consumers
+        struct alignas(64) Shard
+        {
+            std::atomic<int64_t> count{0};
+        };
+        std::vector<Shard> shards;
+
+        void add(int64_t delta)
+        {
+            auto &count = shards[omp_get_thread_num()].count;
+            count.store(count.load(std::memory_order_relaxed) + delta, std::memory_order_relaxed);
+        }
+
+    public:
+        Sharded() : shards(size_t(omp_get_max_threads())) {}
+
+        void pushed() { add(1); }
+        void popped() { add(-1); }
+
+        int get() const
+        {
+            int64_t to_rtn = 0;
+            for (auto const &s : shards)
+                to_rtn += s.count.load(std::memory_order_relaxed);
+            return clamp(to_rtn);
+        }
+    };
+
+    struct Tickets
+    {
+        alignas(64) std::atomic<uint64_t> enqueued{0};
+        alignas(64) std::atomic<uint64_t> dequeued{0};
+
+        void pushed() { enqueued.fetch_add(1, std::memory_order_relaxed); }
+        void popped() { dequeued.fetch_add(1, std::memory_order_relaxed); }
+
+        int get() const
+        {
+            uint64_t out = dequeued.load(std::memory_order_relaxed);
+            uint64_t in = enqueued.load(std::memory_order_relaxed);
+            return clamp(int64_t(in - out));
+        }
+    };
+
+    // Calls f.template operator()<Policy>() with the policy of kind
+    template <typename F>
+    auto dispatch(Kind kind, F &&f)
+    {
+        switch (kind)
+        {
+        case Kind::None:
+            return f.template operator()<None>();
+        case Kind::Sharded:
+            return f.template operator()<Sharded>();
+        case Kind::Tickets:
+            return f.template operator()<Tickets>();
+        case Kind::Shared:
+            break;
+        }
+        return f.template operator()<Shared>();
+    }
+}; // namespace sizing
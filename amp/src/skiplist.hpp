@@ -0,0 +1,345 @@
+/*
+Lock free priority queue on a skiplist (Lindén and Jonsson, "A skiplist-based
+concurrent priority queue with minimal memory contention").
+
+The value is the priority: push inserts it, pop removes the smallest one,
+equal values come out in insertion order. Since generics::encode grows with
+the sequence number, a producer's values still come out in the order it
+pushed them, so --verify holds as for the FIFO queues. The FIFO
+linearizability check (history.hpp) does not apply.
+
+Nodes are sorted along links[0], the higher levels skip ahead as in any
+skiplist. A pop does not unlink the node it takes, it sets the mark bit of
+its predecessor's links[0] with one fetch_or, so the deleted nodes form a
+prefix of the list behind the head and pops walk it to the first unmarked
+link. Pushes never insert into the prefix. Only once a pop walked more than
+bound_offset deleted nodes, it unlinks the whole prefix with one CAS on the
+head's links[0] and then moves the head's higher links past it
+(restructure). So pops rarely write to the same cache lines, unlike the
+single head of the FIFO queues.
+
+A pop stops the prefix at the first node whose push has not yet linked all
+its levels (inserting), that push could still link it behind the new head.
+
+Unlinked nodes may still be walked by other threads, so they are retired to
+the epoch domain of ebr.hpp and only reach the free list (fine_lock's, one
+per thread) after their grace period. Every operation runs inside the
+domain. Nodes carry all max_level links so that any node can be reused for
+any height.
+*/
+
+#pragma once
+#include "backoff.hpp"
+#include "base_queue.hpp"
+#include "ebr.hpp"
+#include "fine_lock.hpp"
+#include "generics.hpp"
+#include "instrumentation.hpp"
+#include "payload.hpp"
+#include "sizing.hpp"
+
+#include <omp.h>
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace skiplist
+{
+    using value_t = generics::value_t;
+    inline constexpr value_t empty_val = generics::empty_val;
+
+    inline constexpr int max_level = 16;         // enough for ~2^16 elements
+    inline constexpr unsigned bound_offset = 32; // deleted nodes a pop walks before it unlinks them
+
+    // The skiplist links are tagged with one mark bit: set on links[0] when
+    // the node it points to is deleted
+    template <typename Slot>
+    struct alignas(64) BasicNode
+    {
+        value_t value;
+        std::atomic<bool> inserting{false};
+        BasicNode *next{nullptr}; // free and limbo lists only
+        [[no_unique_address]] Slot payload;
+        std::atomic<uintptr_t> links[max_level];
+
+        BasicNode() : value(empty_val)
+        {
+            for (auto &l : links)
+                l.store(0, std::memory_order_relaxed);
+        }
+    };
+
+    inline bool marked(uintptr_t link) { return (link & 1) != 0; }
+
+    template <typename Node>
+    Node *target(uintptr_t link)
+    {
+        return reinterpret_cast<Node *>(link & ~uintptr_t(1));
+    }
+
+    template <typename Node>
+    uintptr_t link_to(Node *n, bool mark = false)
+    {
+        return reinterpret_cast<uintptr_t>(n) | uintptr_t(mark);
+    }
+
+    // Level 1 with probability 1/2, 2 with 1/4, ...
+    inline int random_level()
+    {
+        // xorshift, one state per thread
+        thread_local uint64_t state = 0x9E3779B97F4A7C15ull ^ uint64_t(omp_get_thread_num() + 1);
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        return std::min(1 + std::countr_one(state), max_level);
+    }
+
+    template <typename Instr = instrumentation::None, typename Backoff = backoff::None,
+              typename Payload = payload::None, typename Size = sizing::Shared>
+    class BasicQueue : public BaseQueue
+    {
+        using Node = BasicNode<typename Payload::Slot>;
+        using FreeList = fine_lock::BasicFreeList<Node>;
+
+        Node *head; // value below every pushed one
+        Node *tail; // value above every pushed one
+
+        alignas(64) std::vector<FreeList> freelists;
+        ebr::Domain<Node> epochs;
+        Instr instr;
+        Payload messages;
+        Backoff manager;
+        Size tracker;
+
+        auto recycle()
+        {
+            return [this](Node *n)
+            { freelists[omp_get_thread_num()].push(n); };
+        }
+
+        // Fills the predecessors and successors of k on every level, behind
+        // the deleted prefix. Returns the last deleted node seen on level 0.
+        Node *locate_preds(value_t k, Node **preds, Node **succs) const
+        {
+            Node *x = head;
+            Node *deleted = nullptr;
+            for (int i = max_level - 1; i >= 0; --i)
+            {
+                uintptr_t link = x->links[i].load(std::memory_order_acquire);
+                Node *x_next = target<Node>(link);
+                // Past equal values, so they come out in insertion order
+                while ((x_next != tail && x_next->value <= k) ||
+                       marked(x_next->links[0].load(std::memory_order_acquire)) ||
+                       (i == 0 && marked(link)))
+                {
+                    if (i == 0 && marked(link))
+                        deleted = x_next;
+                    x = x_next;
+                    link = x->links[i].load(std::memory_order_acquire);
+                    x_next = target<Node>(link);
+                }
+                preds[i] = x;
+                succs[i] = x_next;
+            }
+            return deleted;
+        }
+
+        // Moves the head's higher links past the deleted prefix
+        void restructure()
+        {
+            instr.help();
+            Node *pred = head;
+            int i = max_level - 1;
+            while (i > 0)
+            {
+                uintptr_t h = head->links[i].load(std::memory_order_acquire);
+                if (!marked(target<Node>(h)->links[0].load(std::memory_order_acquire)))
+                {
+                    --i;
+                    continue;
+                }
+                Node *cur = target<Node>(pred->links[i].load(std::memory_order_acquire));
+                while (marked(cur->links[0].load(std::memory_order_acquire)))
+                {
+                    pred = cur;
+                    cur = target<Node>(pred->links[i].load(std::memory_order_acquire));
+                }
+                bool moved = head->links[i].compare_exchange_strong(h, pred->links[i].load(std::memory_order_acquire));
+                instr.cas(moved);
+                if (moved)
+                    --i;
+            }
+        }
+
+    public:
+        explicit BasicQueue(Backoff backoff_policy = Backoff{}) : manager(backoff_policy)
+        {
+            head = new Node;
+            tail = new Node;
+            head->value = std::numeric_limits<value_t>::min();
+            tail->value = std::numeric_limits<value_t>::max();
+            for (auto &l : head->links)
+                l.store(link_to(tail), std::memory_order_relaxed);
+
+            int n_threads = omp_get_max_threads();
+            freelists.resize(n_threads);
+        }
+
+        // Level 0 holds every node that was not retired
+        ~BasicQueue()
+        {
+            Node *walker = head;
+            while (walker != nullptr)
+            {
+                Node *current = walker;
+                walker = current == tail ? nullptr : target<Node>(current->links[0].load(std::memory_order_relaxed));
+                delete current;
+            }
+        }
+
+        BasicQueue(BasicQueue const &) = delete;
+        BasicQueue(BasicQueue &&) = delete;
+        BasicQueue &operator=(BasicQueue const &) = delete;
+        BasicQueue &operator=(BasicQueue &&) = delete;
+
+        bool push(value_t val) override
+        {
+            int tid = omp_get_thread_num();
+            epochs.enter(recycle());
+
+            Node *n = freelists[tid].get();
+            instr.freelist(n != nullptr);
+            if (n == nullptr)
+                n = freelists[tid].allocate();
+            n->value = val;
+            n->inserting.store(true, std::memory_order_relaxed);
+            messages.write(n->payload, val);
+            int height = random_level();
+
+            Node *preds[max_level];
+            Node *succs[max_level];
+            Node *deleted;
+            unsigned attempts = 0;
+            while (true)
+            {
+                deleted = locate_preds(val, preds, succs);
+                n->links[0].store(link_to(succs[0]), std::memory_order_relaxed);
+                uintptr_t expected = link_to(succs[0]);
+                bool linked = preds[0]->links[0].compare_exchange_strong(expected, link_to(n));
+                instr.cas(linked);
+                if (linked)
+                    break;
+                manager.failed(attempts);
+            }
+            tracker.pushed();
+
+            // The higher levels are a hint, give up once n or its successor got deleted
+            for (int i = 1; i < height;)
+            {
+                n->links[i].store(link_to(succs[i]), std::memory_order_relaxed);
+                if (marked(n->links[0].load(std::memory_order_acquire)) ||
+                    marked(succs[i]->links[0].load(std::memory_order_acquire)) || deleted == succs[i])
+                    break;
+                uintptr_t expected = link_to(succs[i]);
+                bool linked = preds[i]->links[i].compare_exchange_strong(expected, link_to(n));
+                instr.cas(linked);
+                if (linked)
+                {
+                    ++i;
+                    continue;
+                }
+                deleted = locate_preds(val, preds, succs);
+                if (succs[0] != n)
+                    break; // n got deleted
+            }
+            n->inserting.store(false, std::memory_order_release);
+
+            epochs.exit();
+            return true;
+        }
+
+        value_t pop() override
+        {
+            epochs.enter(recycle());
+
+            // Walk the deleted prefix and mark the first link that is not
+            uintptr_t observed = head->links[0].load(std::memory_order_acquire);
+            Node *x = head;
+            Node *new_head = nullptr;
+            unsigned offset = 0;
+            uintptr_t link;
+            do
+            {
+                link = x->links[0].load(std::memory_order_acquire);
+                if (target<Node>(link) == tail)
+                {
+                    epochs.exit();
+                    return empty_val;
+                }
+                if (new_head == nullptr && x->inserting.load(std::memory_order_acquire))
+                    new_head = x;
+                if (!marked(link))
+                {
+                    link = x->links[0].fetch_or(1);
+                    instr.cas(!marked(link));
+                }
+                ++offset;
+                x = target<Node>(link);
+            } while (marked(link));
+
+            value_t val = x->value;
+            messages.consume(messages.take(x->payload));
+            tracker.popped();
+            if (new_head == nullptr)
+                new_head = x;
+
+            // Unlink the prefix up to new_head, which stays as the first deleted node
+            if (offset > bound_offset && head->links[0].load(std::memory_order_acquire) == observed)
+            {
+                bool moved = head->links[0].compare_exchange_strong(observed, link_to(new_head, true));
+                instr.cas(moved);
+                if (moved)
+                {
+                    restructure();
+                    Node *current = target<Node>(observed);
+                    while (current != new_head)
+                    {
+                        Node *next = target<Node>(current->links[0].load(std::memory_order_relaxed));
+                        epochs.retire(current, recycle());
+                        current = next;
+                    }
+                }
+            }
+
+            epochs.exit();
+            return val;
+        }
+
+        int get_size() override
+        {
+            return tracker.get();
+        }
+
+        std::optional<instrumentation::Contention> contention() const override { return instr.contention(); }
+        void reset_contention() override { instr.reset(); }
+
+        // Nodes waiting for their grace period count as allocated, not free
+        std::optional<memory::Allocation> allocation() const override
+        {
+            memory::Allocation to_rtn{sizeof(Node), 2, {}, // head and tail
+                                      messages.buffer_bytes(), messages.buffers_allocated()};
+            for (auto const &f : freelists)
+            {
+                to_rtn.nodes_allocated += f.get_allocated();
+                to_rtn.free_nodes.push_back(f.get_size());
+            }
+            return to_rtn;
+        }
+    };
+
+    using Queue = BasicQueue<>;
+}; // namespace skiplist
@@ -0,0 +1,30 @@
+/*
+Busy waiting helpers shared by the locks and the hardware microbenchmarks.
+The waiters pause between polls and yield every 1024 polls, so spinning
+threads still make progress when there are more threads than cpus.
+*/
+
+#pragma once
+#include <thread>
+
+namespace spin
+{
+    inline void relax()
+    {
+#if defined(__x86_64__) || defined(__i386__)
+        __builtin_ia32_pause();
+#endif
+    }
+
+    // Spins until pred holds
+    template <typename Pred>
+    void until(Pred pred)
+    {
+        for (unsigned spins = 1; !pred(); ++spins)
+        {
+            relax();
+            if (spins % 1024 == 0)
+                std::this_thread::yield();
+        }
+    }
+}; // namespace spin
@@ -0,0 +1,161 @@
+/*
+Summary statistics over per-repetition samples.
+
+The benchmark keeps one sample per repetition and reports the mean, the
+median, the sample standard deviation and the half width of the 95%
+confidence interval of the mean (Student t, n - 1 degrees of freedom).
+
+mann_whitney_less compares two sets of samples without assuming a
+distribution, which suits throughputs of a handful of repetitions.
+*/
+
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <numeric>
+#include <vector>
+
+namespace stats
+{
+    struct Statistics
+    {
+        double mean{};
+        double median{};
+        double stddev{};
+        double ci95{}; // half width of the 95% confidence interval
+    };
+
+    // Two sided 97.5% quantiles of the t distribution for 1..30 degrees of
+    // freedom. Larger samples use the normal approximation.
+    inline double t_quantile_975(size_t dof)
+    {
+        static constexpr std::array<double, 30> table{
+            12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306,
+            2.262, 2.228, 2.201, 2.179, 2.160, 2.145, 2.131, 2.120,
+            2.110, 2.101, 2.093, 2.086, 2.080, 2.074, 2.069, 2.064,
+            2.060, 2.056, 2.052, 2.048, 2.045, 2.042};
+
+        if (dof == 0)
+            return 0.0;
+        if (dof <= table.size())
+            return table[dof - 1];
+        return 1.960;
+    }
+
+    inline Statistics describe(std::vector<double> samples)
+    {
+        Statistics to_rtn{};
+        size_t n = samples.size();
+        if (n == 0)
+            return to_rtn;
+
+        to_rtn.mean = std::accumulate(samples.begin(), samples.end(), 0.0) / n;
+
+        std::sort(samples.begin(), samples.end());
+        to_rtn.median = (n % 2 == 1)
+                            ? samples[n / 2]
+                            : 0.5 * (samples[n / 2 - 1] + samples[n / 2]);
+
+        if (n < 2)
+            return to_rtn;
+
+        double sq_sum = 0.0;
+        for (double s : samples)
+            sq_sum += (s - to_rtn.mean) * (s - to_rtn.mean);
+
+        to_rtn.stddev = std::sqrt(sq_sum / (n - 1));
+        to_rtn.ci95 = t_quantile_975(n - 1) * to_rtn.stddev / std::sqrt(double(n));
+        return to_rtn;
+    }
+
+    // Jain's fairness index (sum x)^2 / (n sum x^2): 1 if all shares are
+    // equal, 1/n if one share takes everything. 1 for an empty input.
+    inline double jain(std::vector<double> const &shares)
+    {
+        double sum = 0.0, sq_sum = 0.0;
+        for (double x : shares)
+        {
+            sum += x;
+            sq_sum += x * x;
+        }
+        if (sq_sum <= 0.0)
+            return 1.0;
+        return sum * sum / (double(shares.size()) * sq_sum);
+    }
+
+    // One sided Mann-Whitney U test, p-value of "a tends to be smaller than
+    // b". Exact for small samples without ties, otherwise the normal
+    // approximation with tie and continuity correction. With m and n
+    // samples the smallest possible p is 1 / binomial(m + n, m), e.g. 1/70
+    // for 4 against 4.
+    inline double mann_whitney_less(std::vector<double> const &a, std::vector<double> const &b)
+    {
+        size_t m = a.size(), n = b.size();
+        if (m == 0 || n == 0)
+            return 1.0;
+
+        // U of a: pairs where a is larger, ties count half
+        double u = 0;
+        bool ties = false;
+        for (double x : a)
+            for (double y : b)
+            {
+                u += x > y ? 1.0 : x == y ? 0.5 : 0.0;
+                ties = ties || x == y;
+            }
+
+        if (!ties && m * n <= 400)
+        {
+            // count[i][j][k]: orderings of i values of a and j of b with U = k
+            std::vector<double> count((m + 1) * (n + 1) * (m * n + 1), 0.0);
+            auto at = [&](size_t i, size_t j, size_t k) -> double &
+            { return count[(i * (n + 1) + j) * (m * n + 1) + k]; };
+            for (size_t i = 0; i <= m; ++i)
+                for (size_t j = 0; j <= n; ++j)
+                    for (size_t k = 0; k <= i * j; ++k)
+                    {
+                        if (i == 0 || j == 0)
+                        {
+                            at(i, j, k) = k == 0 ? 1.0 : 0.0;
+                            continue;
+                        }
+                        // The largest value is from a (beats all j of b) or from b
+                        at(i, j, k) = (k >= j ? at(i - 1, j, k - j) : 0.0) + at(i, j - 1, k);
+                    }
+
+            double below = 0, total = 0;
+            for (size_t k = 0; k <= m * n; ++k)
+            {
+                total += at(m, n, k);
+                if (double(k) <= u)
+                    below += at(m, n, k);
+            }
+            return below / total;
+        }
+
+        // Tie correction over the pooled samples
+        std::vector<double> pooled(a);
+        pooled.insert(pooled.end(), b.begin(), b.end());
+        std::sort(pooled.begin(), pooled.end());
+        double tie_sum = 0;
+        for (size_t i = 0; i < pooled.size();)
+        {
+            size_t j = i;
+            while (j < pooled.size() && pooled[j] == pooled[i])
+                ++j;
+            double t = double(j - i);
+            tie_sum += t * t * t - t;
+            i = j;
+        }
+
+        double N = double(m + n);
+        double mean = double(m * n) / 2.0;
+        double var = double(m * n) / 12.0 * ((N + 1.0) - tie_sum / (N * (N - 1.0)));
+        if (var <= 0)
+            return 1.0;
+        double z = (u + 0.5 - mean) / std::sqrt(var);
+        return 0.5 * std::erfc(-z / std::sqrt(2.0));
+    }
+}; // namespace stats
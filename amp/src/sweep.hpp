@@ -0,0 +1,208 @@
+/*
+In process sweep over queue types x thread counts x recipes x batch sizes
+x payload sizes.
+
+All push batches are generated once for the largest thread count and every
+batch size, then every point of the matrix runs in the same process and
+streams one CSV line (and optionally one JSON record) as soon as it is
+done. The order of the points can be
+
+  sequential  : type, threads, recipe, batch, payload (type changes slowest)
+  interleaved : threads, recipe, batch, payload, type (all types of a point run
+                back to back, so slow drift of the machine hits them alike)
+  random      : shuffled with the seed of the sweep
+
+With three or more thread counts the sweep ends with a Universal
+Scalability Law fit per type, recipe, batch and payload size (scalability.hpp),
+printed to stderr.
+*/
+
+#pragma once
+#include "benchmark.hpp"
+#include "queues.hpp"
+#include "scalability.hpp"
+
+#include <algorithm>
+#include <iostream>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace sweep
+{
+    enum class Order
+    {
+        Sequential,
+        Interleaved,
+        Random
+    };
+
+    struct Spec
+    {
+        std::vector<std::string> types;
+        std::vector<int> threads;
+        std::vector<ConfigRecipe> recipes;
+        std::vector<std::string> recipe_names; // same order as recipes
+        std::vector<int> batch_sizes{0};       // 0 keeps the recipe default
+        std::vector<size_t> payload_sizes{0};  // bytes per element, 0 for the value only
+        Order order{Order::Sequential};
+
+        // Shared by every point
+        int repetitions{1};
+        int max_time_in_s{1};
+        int sets{0};
+        int seed{42};
+        double warmup_time_in_s{};
+        bool perf_counters{false};
+        bool verify{false};
+        bool contention{false}; // instrumented queues (instrumentation.hpp)
+        backoff::Kind backoff{backoff::Kind::None};
+        backoff::Parameters backoff_parameters{};
+        payload::Mode payload_mode{payload::Mode::Inline};
+        sizing::Kind size_tracking{sizing::Kind::Shared};
+        double telemetry_interval_ms{};
+        size_t telemetry_capacity{4096};
+        std::string telemetry_output; // CSV of the time series, empty for none
+        size_t latency_sample{};
+        hwbench::Characterization const *hardware{nullptr};
+        affinity::Placement placement{affinity::Placement::None};
+        std::vector<int> cpu_list;
+        int predict_threads{0}; // report the fitted throughput there, 0 for none
+    };
+
+    struct Point
+    {
+        std::string type;
+        int threads;
+        size_t recipe; // index into Spec::recipes
+        int batch_size;
+        size_t payload_bytes;
+    };
+
+    inline std::vector<Point> points(Spec const &spec)
+    {
+        std::vector<Point> to_rtn;
+        for (auto const &type : spec.types)
+            for (int threads : spec.threads)
+                for (size_t r = 0; r < spec.recipes.size(); ++r)
+                    for (int batch : spec.batch_sizes)
+                        for (size_t bytes : spec.payload_sizes)
+                        {
+                            if (queues::is_sequential(type) && threads != 1)
+                                continue;
+                            to_rtn.push_back({type, threads, r, batch, bytes});
+                        }
+
+        switch (spec.order)
+        {
+        case Order::Interleaved:
+        {
+            auto type_rank = [&](std::string const &type)
+            {
+                return std::find(spec.types.begin(), spec.types.end(), type) - spec.types.begin();
+            };
+            std::stable_sort(to_rtn.begin(), to_rtn.end(), [&](Point const &a, Point const &b)
+                             { return std::make_tuple(a.threads, a.recipe, a.batch_size, a.payload_bytes, type_rank(a.type)) <
+                                      std::make_tuple(b.threads, b.recipe, b.batch_size, b.payload_bytes, type_rank(b.type)); });
+            break;
+        }
+        case Order::Random:
+        {
+            std::mt19937 rng(spec.seed);
+            std::shuffle(to_rtn.begin(), to_rtn.end(), rng);
+            break;
+        }
+        default:
+            break;
+        }
+        return to_rtn;
+    }
+
+    // Runs every point and streams the results. Returns the number of points
+    // that had to be skipped because their config was not valid.
+    inline size_t run(Spec const &spec, bool print_header, std::string const &output)
+    {
+        std::vector<Point> todo = points(spec);
+
+        int max_threads = *std::max_element(spec.threads.begin(), spec.threads.end());
+        std::vector<uint> batch_sizes;
+        for (auto const &point : todo)
+        {
+            Config config = ConfigFactory{point.threads, spec.repetitions, spec.max_time_in_s,
+                                          spec.sets, spec.seed, spec.recipes[point.recipe],
+                                          point.batch_size}();
+            for (int b : config.batch_enque)
+                if (std::find(batch_sizes.begin(), batch_sizes.end(), uint(b)) == batch_sizes.end())
+                    batch_sizes.push_back(uint(b));
+        }
+        InputPool pool(spec.seed, uint(max_threads), batch_sizes);
+
+        // The queues size their per thread free lists with omp_get_max_threads()
+        omp_set_num_threads(max_threads);
+
+        size_t skipped = 0;
+        bool header = print_header;
+        std::map<std::string, std::vector<scalability::Point>> series;
+        for (auto const &point : todo)
+        {
+            Config config = ConfigFactory{point.threads, spec.repetitions, spec.max_time_in_s,
+                                          spec.sets, spec.seed, spec.recipes[point.recipe],
+                                          point.batch_size}();
+            config.warmup_time_in_s = spec.warmup_time_in_s;
+            config.perf_counters = spec.perf_counters;
+            config.verify = spec.verify;
+            config.telemetry_interval_ms = spec.telemetry_interval_ms;
+            config.telemetry_capacity = spec.telemetry_capacity;
+            config.latency_sample = spec.latency_sample;
+            config.placement = spec.placement;
+            config.cpu_list = spec.cpu_list;
+            config.backoff = spec.backoff;
+            config.backoff_parameters = spec.backoff_parameters;
+            config.payload_bytes = point.payload_bytes;
+            config.payload_mode = spec.payload_mode;
+            config.size_tracking = spec.size_tracking;
+
+            if (!config.is_config_correct())
+            {
+                std::cerr << "Skipping " << point.type << " threads=" << point.threads
+                          << " recipe=" << spec.recipe_names[point.recipe]
+                          << " batch=" << point.batch_size
+                          << " payload=" << point.payload_bytes << std::endl;
+                ++skipped;
+                continue;
+            }
+
+            Benchmark benchmark{std::move(config)};
+            benchmark.set_inputs(&pool);
+            benchmark.set_hardware(spec.hardware);
+            auto queue = queues::make_queue(point.type, spec.contention, spec.backoff,
+                                            point.payload_bytes, spec.payload_mode, spec.backoff_parameters,
+                                            spec.size_tracking);
+
+            if (spec.sets != 0)
+                benchmark.run_sets(*queue);
+            else
+                benchmark.run_fast(*queue);
+
+            std::string series_name = point.type + " " + spec.recipe_names[point.recipe];
+            if (point.batch_size != 0)
+                series_name += " batch=" + std::to_string(point.batch_size);
+            if (point.payload_bytes != 0)
+                series_name += " payload=" + std::to_string(point.payload_bytes);
+            for (auto const &s : benchmark.get_results().samples)
+                series[series_name].push_back({point.threads, s.throughput});
+
+            benchmark.print_csv(point.type, header);
+            header = false;
+            if (!output.empty())
+                benchmark.save_results(output, point.type);
+            if (!spec.telemetry_output.empty())
+                benchmark.save_telemetry(spec.telemetry_output, point.type);
+        }
+
+        if (spec.threads.size() >= 3)
+            scalability::print(std::cerr, series, spec.predict_threads);
+        return skipped;
+    }
+}; // namespace sweep
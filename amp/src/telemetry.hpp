@@ -0,0 +1,175 @@
+/*
+Time series telemetry of a run.
+
+The benchmark threads publish their cumulative operation count once per
+batch into their own cache line (Progress). A separate sampler thread wakes
+up every interval, copies those counters and the queue's get_size() into a
+ring preallocated at construction, so sampling never allocates. Once the
+ring is full the oldest samples are overwritten.
+
+get_size() of the sequential queue is a plain read racing with the owning
+thread; for it the depth is only an estimate. Queues built with
+--size_tracking none report a depth of -1.
+*/
+
+#pragma once
+#include "base_queue.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+namespace telemetry
+{
+    struct alignas(64) Progress
+    {
+        std::atomic<uint64_t> operations{0};
+    };
+
+    // Samples of one repetition, oldest first once read through at()
+    class Series
+    {
+        size_t capacity_ = 0;
+        size_t n_threads_ = 0;
+        size_t head = 0; // next slot to write
+        size_t count = 0;
+
+        std::vector<double> times; // s since the start of the repetition
+        std::vector<int> depths;
+        std::vector<uint64_t> ops; // capacity x n_threads, cumulative
+
+    public:
+        double interval_ms = 0;
+
+        Series() = default;
+        Series(size_t capacity, size_t n_threads, double interval)
+            : capacity_(capacity), n_threads_(n_threads), times(capacity),
+              depths(capacity), ops(capacity * n_threads), interval_ms(interval) {}
+
+        void record(double t, int depth, std::vector<Progress> const &progress)
+        {
+            if (capacity_ == 0)
+                return;
+            times[head] = t;
+            depths[head] = depth;
+            for (size_t th = 0; th < n_threads_; ++th)
+                ops[head * n_threads_ + th] = progress[th].operations.load(std::memory_order_relaxed);
+            head = (head + 1) % capacity_;
+            count = std::min(count + 1, capacity_);
+        }
+
+        size_t size() const { return count; }
+        size_t n_threads() const { return n_threads_; }
+        bool wrapped() const { return count == capacity_ && capacity_ != 0; }
+
+        // i-th oldest sample still in the ring
+        size_t slot(size_t i) const { return wrapped() ? (head + i) % capacity_ : i; }
+        double time(size_t i) const { return times[slot(i)]; }
+        int depth(size_t i) const { return depths[slot(i)]; }
+        uint64_t operations(size_t i, size_t thread) const { return ops[slot(i) * n_threads_ + thread]; }
+
+        uint64_t operations(size_t i) const
+        {
+            uint64_t to_rtn = 0;
+            for (size_t th = 0; th < n_threads_; ++th)
+                to_rtn += operations(i, th);
+            return to_rtn;
+        }
+
+        // Rotates a wrapped ring so that the oldest sample is in slot 0.
+        // Afterwards the storage below is in time order; recording more
+        // samples keeps working.
+        void linearize()
+        {
+            if (!wrapped() || head == 0)
+                return;
+            std::rotate(times.begin(), times.begin() + head, times.end());
+            std::rotate(depths.begin(), depths.begin() + head, depths.end());
+            std::rotate(ops.begin(), ops.begin() + head * n_threads_, ops.end());
+            head = 0;
+        }
+
+        // Raw storage, in time order after linearize(); ops is size() x n_threads
+        double const *times_data() const { return times.data(); }
+        int const *depths_data() const { return depths.data(); }
+        uint64_t const *operations_data() const { return ops.data(); }
+    };
+
+    class Sampler
+    {
+        BaseQueue &queue;
+        std::vector<Progress> const &progress;
+        Series &series;
+        std::chrono::microseconds interval;
+
+        std::atomic<bool> stop_flag{false};
+        std::thread worker;
+
+        void loop()
+        {
+            using clock = std::chrono::steady_clock;
+            auto start = clock::now();
+            auto next = start;
+            while (!stop_flag.load(std::memory_order_relaxed))
+            {
+                next += interval;
+                std::this_thread::sleep_until(next);
+                double t = std::chrono::duration<double>(clock::now() - start).count();
+                series.record(t, queue.get_size(), progress);
+            }
+        }
+
+    public:
+        Sampler(BaseQueue &q, std::vector<Progress> const &p, Series &s)
+            : queue(q), progress(p), series(s),
+              interval(static_cast<int64_t>(s.interval_ms * 1000.0)) {}
+
+        ~Sampler() { stop(); }
+
+        Sampler(Sampler const &) = delete;
+        Sampler &operator=(Sampler const &) = delete;
+
+        void start() { worker = std::thread(&Sampler::loop, this); }
+
+        void stop()
+        {
+            stop_flag.store(true, std::memory_order_relaxed);
+            if (worker.joinable())
+                worker.join();
+        }
+    };
+
+    // Everything one repetition needs: the counters, the ring and the sampler
+    class Recorder
+    {
+        std::vector<Progress> progress;
+        Series series;
+        Sampler sampler;
+
+    public:
+        Recorder(BaseQueue &queue, size_t n_threads, double interval_ms, size_t capacity)
+            : progress(n_threads), series(capacity, n_threads, interval_ms),
+              sampler(queue, progress, series) {}
+
+        Recorder(Recorder const &) = delete;
+        Recorder &operator=(Recorder const &) = delete;
+
+        void start() { sampler.start(); }
+
+        // Called by the benchmark thread itself, once per batch
+        void publish(size_t thread, uint64_t operations)
+        {
+            progress[thread].operations.store(operations, std::memory_order_relaxed);
+        }
+
+        Series finish()
+        {
+            sampler.stop();
+            series.linearize();
+            return std::move(series);
+        }
+    };
+}; // namespace telemetry
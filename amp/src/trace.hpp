@@ -0,0 +1,282 @@
+/*
+Binary workload traces: per thread sequences of push/pop operations.
+
+File layout (little endian, everything naturally aligned):
+
+  Header        magic "AMPTRACE", version, number of threads
+  ThreadEntry   n_threads x (offset in bytes, number of records)
+  Record        16 bytes: value, gap to the previous operation of the
+                thread in ns (0 if unknown), op
+
+A trace is written by Recorder, usually through RecordingQueue which wraps
+any BaseQueue and logs the operations that go through it. Mapped opens a
+trace with mmap and hands out the records of every thread in place, so a
+replay streams the file to the workers without copying it.
+*/
+
+#pragma once
+#include "base_queue.hpp"
+#include "generics.hpp"
+
+#include <fcntl.h>
+#include <omp.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace trace
+{
+    using value_t = generics::value_t;
+
+    inline constexpr char magic[8] = {'A', 'M', 'P', 'T', 'R', 'A', 'C', 'E'};
+    inline constexpr uint32_t version = 1;
+
+    enum class Op : uint8_t
+    {
+        Push,
+        Pop
+    };
+
+    struct Header
+    {
+        char magic[8];
+        uint32_t version;
+        uint32_t n_threads;
+    };
+
+    struct ThreadEntry
+    {
+        uint64_t offset; // bytes from the start of the file
+        uint64_t count;
+    };
+
+    struct Record
+    {
+        value_t value;   // pushed value, or what the pop returned
+        uint32_t gap_ns; // since the previous operation of this thread
+        Op op;
+        uint8_t padding[3]{};
+    };
+
+    static_assert(sizeof(Header) == 16);
+    static_assert(sizeof(ThreadEntry) == 16);
+    static_assert(sizeof(Record) == 16);
+
+    // Per thread, preallocated buffers. Operations beyond the capacity of a
+    // thread are dropped and counted.
+    class Recorder
+    {
+        struct alignas(64) Buffer
+        {
+            std::vector<Record> records;
+            size_t count = 0;
+            int64_t last = -1; // ns of the previous operation
+            uint64_t dropped = 0;
+        };
+        std::vector<Buffer> buffers;
+
+        static int64_t now()
+        {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                       std::chrono::steady_clock::now().time_since_epoch())
+                .count();
+        }
+
+    public:
+        Recorder(size_t n_threads, size_t capacity) : buffers(n_threads)
+        {
+            for (auto &b : buffers)
+                b.records.resize(capacity);
+        }
+
+        void record(size_t thread, Op op, value_t value)
+        {
+            Buffer &b = buffers[thread];
+            if (b.count == b.records.size())
+            {
+                b.dropped++;
+                return;
+            }
+
+            int64_t t = now();
+            uint64_t gap = b.last < 0 ? 0 : uint64_t(t - b.last);
+            b.last = t;
+            b.records[b.count++] = Record{value, uint32_t(std::min<uint64_t>(gap, std::numeric_limits<uint32_t>::max())), op};
+        }
+
+        uint64_t dropped() const
+        {
+            uint64_t to_rtn = 0;
+            for (auto const &b : buffers)
+                to_rtn += b.dropped;
+            return to_rtn;
+        }
+
+        size_t size() const
+        {
+            size_t to_rtn = 0;
+            for (auto const &b : buffers)
+                to_rtn += b.count;
+            return to_rtn;
+        }
+
+        bool save(std::string const &path) const
+        {
+            std::ofstream out(path, std::ios::binary | std::ios::trunc);
+            if (!out)
+                return false;
+
+            Header header{};
+            std::memcpy(header.magic, magic, sizeof(magic));
+            header.version = version;
+            header.n_threads = uint32_t(buffers.size());
+            out.write(reinterpret_cast<char const *>(&header), sizeof(header));
+
+            uint64_t offset = sizeof(Header) + buffers.size() * sizeof(ThreadEntry);
+            for (auto const &b : buffers)
+            {
+                ThreadEntry entry{offset, b.count};
+                out.write(reinterpret_cast<char const *>(&entry), sizeof(entry));
+                offset += b.count * sizeof(Record);
+            }
+            for (auto const &b : buffers)
+                out.write(reinterpret_cast<char const *>(b.records.data()),
+                          std::streamsize(b.count * sizeof(Record)));
+            return bool(out);
+        }
+    };
+
+    // Forwards to the wrapped queue and logs every operation of the calling
+    // omp thread
+    class RecordingQueue : public BaseQueue
+    {
+        BaseQueue &queue;
+        Recorder &recorder;
+
+    public:
+        RecordingQueue(BaseQueue &q, Recorder &r) : queue(q), recorder(r) {}
+
+        bool push(value_t v) override
+        {
+            recorder.record(omp_get_thread_num(), Op::Push, v);
+            return queue.push(v);
+        }
+
+        value_t pop() override
+        {
+            value_t v = queue.pop();
+            recorder.record(omp_get_thread_num(), Op::Pop, v);
+            return v;
+        }
+
+        int get_size() override { return queue.get_size(); }
+
+        std::optional<instrumentation::Contention> contention() const override { return queue.contention(); }
+        void reset_contention() override { queue.reset_contention(); }
+    };
+
+    // Read only mapping of a trace file
+    class Mapped
+    {
+        void *data = MAP_FAILED;
+        size_t length = 0;
+        std::string error_;
+
+        Header const &header() const { return *static_cast<Header const *>(data); }
+
+        ThreadEntry const &entry(size_t thread) const
+        {
+            return reinterpret_cast<ThreadEntry const *>(static_cast<char const *>(data) + sizeof(Header))[thread];
+        }
+
+        bool validate()
+        {
+            if (length < sizeof(Header))
+                return fail("file too short");
+            if (std::memcmp(header().magic, magic, sizeof(magic)) != 0)
+                return fail("not a trace file");
+            if (header().version != version)
+                return fail("unsupported trace version " + std::to_string(header().version));
+            if (header().n_threads == 0 ||
+                length < sizeof(Header) + header().n_threads * sizeof(ThreadEntry))
+                return fail("truncated thread table");
+            for (size_t t = 0; t < header().n_threads; ++t)
+            {
+                ThreadEntry const &e = entry(t);
+                if (e.offset % alignof(Record) != 0 || e.offset > length ||
+                    e.count > (length - e.offset) / sizeof(Record))
+                    return fail("thread " + std::to_string(t) + " points outside the file");
+            }
+            return true;
+        }
+
+        bool fail(std::string message)
+        {
+            error_ = std::move(message);
+            return false;
+        }
+
+    public:
+        // Check ok() / error() afterwards
+        explicit Mapped(std::string const &path)
+        {
+            int fd = ::open(path.c_str(), O_RDONLY);
+            if (fd < 0)
+            {
+                fail("cannot open " + path);
+                return;
+            }
+            struct stat st;
+            if (fstat(fd, &st) == 0 && st.st_size > 0)
+            {
+                length = size_t(st.st_size);
+                // Populate now, so page faults do not land in the timed region
+                data = mmap(nullptr, length, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+            }
+            ::close(fd);
+
+            if (data == MAP_FAILED)
+            {
+                fail("cannot map " + path);
+                return;
+            }
+            madvise(data, length, MADV_SEQUENTIAL);
+            if (!validate())
+            {
+                munmap(data, length);
+                data = MAP_FAILED;
+            }
+        }
+
+        ~Mapped()
+        {
+            if (data != MAP_FAILED)
+                munmap(data, length);
+        }
+
+        Mapped(Mapped const &) = delete;
+        Mapped &operator=(Mapped const &) = delete;
+
+        bool ok() const { return data != MAP_FAILED; }
+        std::string const &error() const { return error_; }
+
+        size_t n_threads() const { return header().n_threads; }
+
+        std::span<Record const> thread(size_t t) const
+        {
+            ThreadEntry const &e = entry(t);
+            return {reinterpret_cast<Record const *>(static_cast<char const *>(data) + e.offset), e.count};
+        }
+    };
+}; // namespace trace
@@ -4,15 +4,34 @@ using pybind11.
 
 Purpose:
 --------
-It exposes the core C++ classes (Config, Benchmark, Results) to Python
-so that benchmarks can be configured and executed from Python scripts.
+It exposes the core C++ classes (Config, Benchmark, Results, Sample) to
+Python so that benchmarks can be configured and executed from Python
+scripts.
 
 Specifically, this file:
 - maps C++ configuration structures to Python-accessible classes
-- exposes benchmark execution methods (run_fast, run_safe, run_sets)
-- provides access to benchmark results
+- exposes benchmark execution methods (run_fast, run_sets)
+- provides access to benchmark results, including per thread data
 - acts as the bridge between high-performance C++ code and flexible Python control
 
+It is built against the maintained sources in amp/src (see the python
+target of the Makefile), so queues are looked up in queues::registry()
+and every queue of the command line tool is available here as well.
+
+Threading:
+----------
+The run_* methods release the GIL while the benchmark runs, so other
+Python threads keep running. Do not use the same Benchmark object from two
+Python threads at the same time.
+
+Per thread data:
+----------------
+Per thread counters, latency histograms and the telemetry time series are
+returned as read only numpy arrays that point straight into the buffers of
+the C++ results, nothing is copied. Each array keeps its Sample, and with
+it the Benchmark, alive. The next run of the same Benchmark overwrites the
+results, copy the arrays (np.array(a)) if they have to outlive it.
+
 Why this file is necessary:
 ---------------------------
 The benchmark core is implemented in C++ for performance, thread control,
@@ -24,34 +43,182 @@ logic nor retrieve structured performance results.
 */
 
 #include <pybind11/pybind11.h>
+#include <pybind11/numpy.h>
 #include <pybind11/stl.h>
 #include "benchmark.hpp"
-#include "fine_lock.hpp"
-#include "lock_free_aba.hpp"
-#include "sequential.hpp"
-#include "lock_guard.hpp"
+#include "queues.hpp"
+
+#include <omp.h>
 
 
 namespace py = pybind11;
 
+namespace
+{
+    // Read only array over memory owned by owner
+    template <typename T>
+    py::array_t<T> view(py::handle owner, T const *data,
+                        std::vector<py::ssize_t> shape, std::vector<py::ssize_t> strides)
+    {
+        py::array_t<T> to_rtn(std::move(shape), std::move(strides), data, owner);
+        py::detail::array_proxy(to_rtn.ptr())->flags &= ~py::detail::npy_api::NPY_ARRAY_WRITEABLE_;
+        return to_rtn;
+    }
+
+    // One field of every per thread Counter, strided over the vector
+    template <typename T>
+    py::array_t<T> per_thread(py::handle owner, std::vector<Counter> const &threads, T Counter::*field)
+    {
+        T const *data = threads.empty() ? nullptr : &(threads.front().*field);
+        return view<T>(owner, data, {py::ssize_t(threads.size())}, {py::ssize_t(sizeof(Counter))});
+    }
+
+    // n_threads x latency::n_buckets
+    py::array_t<uint64_t> per_thread(py::handle owner, std::vector<Counter> const &threads,
+                                     latency::Histogram Counter::*field)
+    {
+        uint64_t const *data = threads.empty() ? nullptr : (threads.front().*field).buckets.data();
+        return view<uint64_t>(owner, data,
+                              {py::ssize_t(threads.size()), py::ssize_t(latency::n_buckets)},
+                              {py::ssize_t(sizeof(Counter)), py::ssize_t(sizeof(uint64_t))});
+    }
+
+    py::array_t<uint64_t> buckets(py::handle owner, latency::Histogram const &h)
+    {
+        return view<uint64_t>(owner, h.buckets.data(), {py::ssize_t(latency::n_buckets)},
+                              {py::ssize_t(sizeof(uint64_t))});
+    }
+
+    // Looks the queue up while the GIL is still held, then runs without it
+    template <typename Run>
+    void run_with(Benchmark &b, std::string const &type, bool instrumented, Run run)
+    {
+        if (!queues::exists(type))
+            throw py::value_error("Unknown queue type: " + type);
+
+        py::gil_scoped_release release;
+        omp_set_num_threads(int(b.get_config().num_threads));
+        std::unique_ptr<BaseQueue> queue = queues::make_queue(type, instrumented, b.get_config().backoff,
+                                                                  b.get_config().payload_bytes,
+                                                                  b.get_config().payload_mode,
+                                                                  b.get_config().backoff_parameters,
+                                                                  b.get_config().size_tracking);
+        run(*queue);
+    }
+}
+
 PYBIND11_MODULE(benchmark_wrapper, m) {
+    m.def("queue_types", &queues::names, "Names accepted by the run_* methods");
+
+    // Upper bound in ns of every latency bucket
+    m.def("latency_bucket_bounds", []() {
+        py::array_t<double> to_rtn(py::ssize_t(latency::n_buckets));
+        auto out = to_rtn.mutable_unchecked<1>();
+        for (size_t b = 0; b < latency::n_buckets; ++b)
+            out(py::ssize_t(b)) = latency::Histogram::upper_bound(b);
+        return to_rtn;
+    });
+
     // --- Enums ---
     py::enum_<ConfigRecipe>(m, "ConfigRecipe")
         .value("Balanced", ConfigRecipe::Balanced)
         .value("ThreadSpecific", ConfigRecipe::ThreadSpecific);
 
+    py::enum_<backoff::Kind>(m, "Backoff")
+        .value("None", backoff::Kind::None)
+        .value("SpinYield", backoff::Kind::SpinYield)
+        .value("Exponential", backoff::Kind::Exponential)
+        .value("Randomized", backoff::Kind::Randomized);
+
+    py::class_<backoff::Parameters>(m, "BackoffParameters")
+        .def(py::init<>())
+        .def_readwrite("min_spins", &backoff::Parameters::min_spins)
+        .def_readwrite("max_spins", &backoff::Parameters::max_spins);
+
+    py::enum_<payload::Mode>(m, "PayloadMode")
+        .value("Inline", payload::Mode::Inline)
+        .value("Pooled", payload::Mode::Pooled);
+
+    py::enum_<sizing::Kind>(m, "SizeTracking")
+        .value("Shared", sizing::Kind::Shared)
+        .value("None", sizing::Kind::None)
+        .value("Sharded", sizing::Kind::Sharded)
+        .value("Tickets", sizing::Kind::Tickets);
+
     // --- Config class ---
     py::class_<Config>(m, "Config")
         .def(py::init<>())
         .def_readwrite("num_threads", &Config::num_threads)
         .def_readwrite("repetitions", &Config::repetitions)
         .def_readwrite("max_time_in_s", &Config::max_time_in_s)
+        .def_readwrite("warmup_time_in_s", &Config::warmup_time_in_s)
         .def_readwrite("sets", &Config::sets)
         .def_readwrite("seed", &Config::seed)
+        .def_readwrite("recipe", &Config::recipe)
+        .def_readwrite("verify", &Config::verify)
         .def_readwrite("batch_enque", &Config::batch_enque)
         .def_readwrite("batch_deque", &Config::batch_deque)
+        .def_readwrite("telemetry_interval_ms", &Config::telemetry_interval_ms)
+        .def_readwrite("telemetry_capacity", &Config::telemetry_capacity)
+        .def_readwrite("latency_sample", &Config::latency_sample)
+        .def_readwrite("backoff", &Config::backoff)
+        .def_readwrite("backoff_parameters", &Config::backoff_parameters)
+        .def_readwrite("payload_bytes", &Config::payload_bytes)
+        .def_readwrite("payload_mode", &Config::payload_mode)
+        .def_readwrite("size_tracking", &Config::size_tracking)
         .def("is_config_correct", &Config::is_config_correct);
 
+    // --- One repetition ---
+    py::class_<Sample>(m, "Sample")
+        .def_readonly("time", &Sample::time)
+        .def_readonly("timeout", &Sample::timeout)
+        .def_readonly("n_operations", &Sample::n_operations)
+        .def_readonly("succeded_enqueues", &Sample::succeded_enqueues)
+        .def_readonly("succeded_dequeues", &Sample::succeded_dequeues)
+        .def_readonly("enqueues", &Sample::enqueues)
+        .def_readonly("dequeues", &Sample::dequeues)
+        .def_readonly("throughput", &Sample::throughput)
+        .def_readonly("fairness", &Sample::fairness)
+        // dict of per thread arrays, one entry per thread
+        .def_property_readonly("threads", [](py::object self) {
+            auto const &threads = self.cast<Sample const &>().threads;
+            py::dict to_rtn;
+            to_rtn["operations"] = per_thread(self, threads, &Counter::total_operations);
+            to_rtn["s_enq"] = per_thread(self, threads, &Counter::succeeded_push);
+            to_rtn["s_deq"] = per_thread(self, threads, &Counter::succeeded_pop);
+            to_rtn["enq"] = per_thread(self, threads, &Counter::total_push);
+            to_rtn["deq"] = per_thread(self, threads, &Counter::total_pop);
+            to_rtn["time"] = per_thread(self, threads, &Counter::time);
+            to_rtn["timeout"] = per_thread(self, threads, &Counter::timeout);
+            return to_rtn;
+        })
+        // n_threads x buckets, see latency_bucket_bounds()
+        .def_property_readonly("push_latency", [](py::object self) {
+            return per_thread(self, self.cast<Sample const &>().threads, &Counter::push_latency);
+        })
+        .def_property_readonly("pop_latency", [](py::object self) {
+            return per_thread(self, self.cast<Sample const &>().threads, &Counter::pop_latency);
+        })
+        // Time series in time order, empty without telemetry_interval_ms
+        .def_property_readonly("telemetry_time", [](py::object self) {
+            auto const &series = self.cast<Sample const &>().telemetry;
+            return view<double>(self, series.times_data(), {py::ssize_t(series.size())},
+                                {py::ssize_t(sizeof(double))});
+        })
+        .def_property_readonly("telemetry_depth", [](py::object self) {
+            auto const &series = self.cast<Sample const &>().telemetry;
+            return view<int>(self, series.depths_data(), {py::ssize_t(series.size())},
+                             {py::ssize_t(sizeof(int))});
+        })
+        // samples x n_threads, cumulative operations per thread
+        .def_property_readonly("telemetry_operations", [](py::object self) {
+            auto const &series = self.cast<Sample const &>().telemetry;
+            return view<uint64_t>(self, series.operations_data(),
+                                  {py::ssize_t(series.size()), py::ssize_t(series.n_threads())},
+                                  {py::ssize_t(series.n_threads() * sizeof(uint64_t)),
+                                   py::ssize_t(sizeof(uint64_t))});
+        });
+
     // --- Results struct ---
     py::class_<Results>(m, "Results")
         .def_readonly("avg_time", &Results::avg_time)
@@ -60,38 +227,64 @@ PYBIND11_MODULE(benchmark_wrapper, m) {
         .def_readonly("total_succeded_enqueues", &Results::total_succeded_enqueues)
         .def_readonly("total_succeded_dequeues", &Results::total_succeded_dequeues)
         .def_readonly("total_enqueues", &Results::total_enqueues)
-        .def_readonly("total_dequeues", &Results::total_dequeues);
-
-    py::class_<Benchmark>(m, "Benchmark")
-        .def(py::init<const Config&>())
-        .def("run_safe", [](Benchmark &b, const std::string &type) {
-            if (type == "global_lock") { global_lock::Queue q; b.run_safe(q); }
-            else if (type == "fine_lock") { fine_lock::Queue q; b.run_safe(q); }
-            else if (type == "lock_free") { lock_free_aba::Queue q; b.run_safe(q); }
-            else if (type == "sequential") { seq::Queue q; b.run_safe(q); }
-            else throw std::runtime_error("Unknown queue type");
+        .def_readonly("total_dequeues", &Results::total_dequeues)
+        .def_readonly("fairness", &Results::fairness)
+        .def_property_readonly("throughput_mean", [](Results const &r) { return r.throughput.mean; })
+        .def_property_readonly("throughput_median", [](Results const &r) { return r.throughput.median; })
+        .def_property_readonly("throughput_stddev", [](Results const &r) { return r.throughput.stddev; })
+        .def_property_readonly("throughput_ci95", [](Results const &r) { return r.throughput.ci95; })
+        .def_property_readonly("samples", [](py::object self) {
+            auto const &samples = self.cast<Results const &>().samples;
+            py::list to_rtn;
+            for (auto const &s : samples)
+                to_rtn.append(py::cast(&s, py::return_value_policy::reference_internal, self));
+            return to_rtn;
         })
-        .def("run_fast", [](Benchmark &b, const std::string &type) {
-            if (type == "global_lock") { global_lock::Queue q; b.run_fast(q); }
-            else if (type == "fine_lock") { fine_lock::Queue q; b.run_fast(q); }
-            else if (type == "lock_free") { lock_free_aba::Queue q; b.run_fast(q); }
-            else if (type == "sequential") { seq::Queue q; b.run_fast(q); }
-            else throw std::runtime_error("Unknown queue type");
+        // Summed over threads and repetitions
+        .def_property_readonly("push_latency", [](py::object self) {
+            return buckets(self, self.cast<Results const &>().push_latency);
         })
-        .def("run_sets", [](Benchmark &b, const std::string &type) {
-            if (type == "global_lock") { global_lock::Queue q; b.run_sets(q); }
-            else if (type == "fine_lock") { fine_lock::Queue q; b.run_sets(q); }
-            else if (type == "lock_free") { lock_free_aba::Queue q; b.run_sets(q); }
-            else if (type == "sequential") { seq::Queue q; b.run_sets(q); }
-            else throw std::runtime_error("Unknown queue type");
+        .def_property_readonly("pop_latency", [](py::object self) {
+            return buckets(self, self.cast<Results const &>().pop_latency);
         })
-        .def("run_cache_checks", [](Benchmark &b) {
-            lock_free_aba::Queue q;
-            return b.run_fast_cache_checks(q);
+        // dict of allocation counters and RSS at the end of the run
+        .def_property_readonly("memory", [](Results const &r) {
+            py::dict to_rtn;
+            to_rtn["rss_peak_kb"] = r.rss.peak_kb;
+            to_rtn["rss_final_kb"] = r.rss.current_kb;
+            if (r.allocation)
+            {
+                to_rtn["node_bytes"] = r.allocation->node_bytes;
+                to_rtn["nodes_allocated"] = r.allocation->nodes_allocated;
+                to_rtn["free_nodes"] = r.allocation->free_nodes;
+            }
+            return to_rtn;
         })
-        .def("print_csv", &Benchmark::print_csv)  // <-- kein Semikolon hier
-        .def("get_results", [](Benchmark &b) -> const Results& {
-            return b.get_results_ref();
+        // dict of counters, None unless the queue was instrumented
+        .def_property_readonly("contention", [](Results const &r) -> py::object {
+            if (!r.contention)
+                return py::none();
+            py::dict to_rtn;
+            auto values = instrumentation::values(*r.contention);
+            for (size_t f = 0; f < values.size(); ++f)
+                to_rtn[py::str(instrumentation::names[f])] = values[f];
+            return to_rtn;
         });
 
+    py::class_<Benchmark>(m, "Benchmark")
+        .def(py::init([](Config cfg) {
+            // The C++ constructor aborts on an invalid config
+            if (!cfg.is_config_correct())
+                throw py::value_error("Invalid benchmark config");
+            return new Benchmark(std::move(cfg));
+        }))
+        .def("run_fast", [](Benchmark &b, std::string const &type, bool instrumented) {
+            run_with(b, type, instrumented, [&](BaseQueue &q) { b.run_fast(q); });
+        }, py::arg("type"), py::arg("instrumented") = false)
+        .def("run_sets", [](Benchmark &b, std::string const &type, bool instrumented) {
+            run_with(b, type, instrumented, [&](BaseQueue &q) { b.run_sets(q); });
+        }, py::arg("type"), py::arg("instrumented") = false)
+        .def("print_csv", &Benchmark::print_csv, py::arg("name"), py::arg("header") = false)
+        .def("get_results", &Benchmark::get_results, py::return_value_policy::reference_internal);
+
 }
@@ -1,3 +1,4 @@
+#include <atomic>
 #include <iostream>
 #include <thread>
 
@@ -5,12 +6,12 @@ class Peterson
 {
 private:
 // is this thread interested in the critical section
-// Needs to be volatile to prevent caching in registers
-    volatile int interested[2] = {0,0};
+// Sequentially consistent atomics: volatile neither stops the compiler nor
+// the cpu from moving the load of interested[other] before our stores
+    std::atomic<int> interested[2] = {0,0};
 
     // who's turn is it?
-    // Needs to be volatile to prevent caching in registers
-    volatile int turn = 0;
+    std::atomic<int> turn = 0;
 public:
 // Method for locking w/ Peterson's alogrithm
     void lock(int tid){